@@ -0,0 +1,103 @@
+#include "../lib/tree.h"
+#include "../lib/concurrent_tree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Read scaling with a 5% write mix: every thread does 95% lookups and
+// 5% insert/erase over the same key range. The baseline is BinaryTree
+// behind one global mutex.
+
+const int kKeyRange = 1 << 17;
+const int kOpsPerThread = 1 << 18;
+const int kWritePercent = 5;
+
+volatile size_t sink;
+
+class LockedBinaryTree {
+public:
+    bool insert(int x) {
+        std::lock_guard guard(lock_);
+        return tree_.insert(x).second;
+    }
+
+    bool erase(int x) {
+        std::lock_guard guard(lock_);
+        return tree_.erase(x);
+    }
+
+    bool contains(int x) {
+        std::lock_guard guard(lock_);
+        return tree_.find(x) != tree_.end();
+    }
+private:
+    std::mutex lock_;
+    BinaryTree<int> tree_;
+};
+
+template <typename Tree>
+double run(Tree& tree, int threads_cnt) {
+    std::vector<std::thread> threads;
+    // one slot per thread, summed into sink after the join
+    std::vector<size_t> found(threads_cnt);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads_cnt; ++t) {
+        threads.emplace_back([&tree, &found, t] {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> key(0, kKeyRange - 1);
+            std::uniform_int_distribution<int> percent(0, 99);
+            size_t hits = 0;
+            for (int i = 0; i < kOpsPerThread; ++i) {
+                int x = key(gen);
+                int p = percent(gen);
+                if (p < kWritePercent / 2) {
+                    tree.insert(x);
+                } else if (p < kWritePercent) {
+                    tree.erase(x);
+                } else {
+                    hits += tree.contains(x);
+                }
+            }
+            found[t] = hits;
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    for (size_t hits: found) {
+        sink = sink + hits;
+    }
+
+    return threads_cnt * static_cast<double>(kOpsPerThread) / elapsed.count();
+}
+
+template <typename Tree>
+void prefill(Tree& tree) {
+    std::mt19937 gen(2024);
+    std::uniform_int_distribution<int> key(0, kKeyRange - 1);
+    for (int i = 0; i < kKeyRange / 2; ++i) {
+        tree.insert(key(gen));
+    }
+}
+
+int main() {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("threads\tlocked_ops_per_sec\tconcurrent_ops_per_sec\tspeedup\n");
+    for (int threads_cnt = 1; threads_cnt <= max_threads; threads_cnt *= 2) {
+        LockedBinaryTree locked;
+        prefill(locked);
+        ConcurrentBinaryTree<int> concurrent;
+        prefill(concurrent);
+        double locked_ops = run(locked, threads_cnt);
+        double concurrent_ops = run(concurrent, threads_cnt);
+        std::printf("%d\t%.0f\t%.0f\t%.2f\n", threads_cnt, locked_ops, concurrent_ops, concurrent_ops / locked_ops);
+    }
+
+    return 0;
+}
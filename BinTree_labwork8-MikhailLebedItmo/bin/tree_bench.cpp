@@ -0,0 +1,185 @@
+#include "../lib/tree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Single threaded operation costs of BinaryTree for every walk type next to
+// std::set. Results go to stdout (or --out) as a JSON array of records
+// {container, input, size, op, ns_per_op} for regression tracking, progress
+// goes to stderr. Usage: tree_bench [--max-size N] [--out path], numbers
+// are only meaningful with -DCMAKE_BUILD_TYPE=Release.
+
+// BinaryTree is not balanced, sorted input makes a chain with O(n) inserts,
+// so larger sorted and reverse runs are reported as skipped
+const size_t kMaxChainSize = 1 << 14;
+
+struct Record {
+    std::string container;
+    std::string input;
+    size_t size;
+    std::string op;
+    double ns_per_op;
+    bool skipped;
+};
+
+std::vector<Record> records;
+volatile size_t sink;
+
+template <typename Func>
+void measure(const std::string& container, const std::string& input,
+             size_t size, const std::string& op, size_t ops, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    sink = sink + func();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    records.push_back({container, input, size, op, elapsed.count() / std::max<size_t>(ops, 1), false});
+    std::fprintf(stderr, "%-22s %-8s %9zu %-12s %10.1f ns/op\n",
+                 container.c_str(), input.c_str(), size, op.c_str(), records.back().ns_per_op);
+}
+
+std::vector<int> make_input(const std::string& kind, size_t size) {
+    std::vector<int> keys(size);
+    std::iota(keys.begin(), keys.end(), 0);
+    for (auto& key: keys) {
+        key *= 2;
+    }
+    if (kind == "random") {
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(size));
+    } else if (kind == "reverse") {
+        std::reverse(keys.begin(), keys.end());
+    }
+    return keys;
+}
+
+template <typename Tree>
+size_t traverse(const Tree& tree) {
+    size_t sum = 0;
+    for (auto x: tree) {
+        sum += x;
+    }
+    return sum;
+}
+
+template <typename Tree>
+void run(const std::string& container, const std::string& input, const std::vector<int>& keys) {
+    size_t size = keys.size();
+    std::vector<int> probes(keys);
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(size + 1));
+    // odd probes fall between keys, so lower_bound does not stop early
+    std::vector<int> between(probes);
+    for (auto& probe: between) {
+        ++probe;
+    }
+
+    Tree tree;
+    measure(container, input, size, "insert", size, [&] {
+        for (int key: keys) {
+            tree.insert(key);
+        }
+        return tree.size();
+    });
+    measure(container, input, size, "find", size, [&] {
+        size_t found = 0;
+        for (int probe: probes) {
+            found += tree.find(probe) != tree.end();
+        }
+        return found;
+    });
+    measure(container, input, size, "lower_bound", size, [&] {
+        size_t sum = 0;
+        for (int probe: between) {
+            auto it = tree.lower_bound(probe);
+            sum += it != tree.end() ? *it : 0;
+        }
+        return sum;
+    });
+    measure(container, input, size, "traversal", size, [&] {
+        return traverse(tree);
+    });
+    measure(container, input, size, "copy", size, [&] {
+        Tree copy(tree);
+        return copy.size();
+    });
+    Tree even;
+    Tree odd;
+    for (size_t i = 0; i < size; ++i) {
+        (i % 2 ? odd : even).insert(keys[i]);
+    }
+    // per moved element
+    measure(container, input, size, "merge", size / 2, [&] {
+        even.merge(odd);
+        return even.size();
+    });
+    measure(container, input, size, "erase", size, [&] {
+        size_t erased = 0;
+        for (int probe: probes) {
+            erased += tree.erase(probe);
+        }
+        return erased;
+    });
+}
+
+void skip(const std::string& container, const std::string& input, size_t size) {
+    for (const char* op: {"insert", "find", "lower_bound", "traversal", "copy", "merge", "erase"}) {
+        records.push_back({container, input, size, op, 0, true});
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t max_size = 10'000'000;
+    const char* out_path = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--max-size") == 0) {
+            max_size = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--out") == 0) {
+            out_path = argv[i + 1];
+        }
+    }
+
+    for (size_t size = 1000; size <= max_size; size *= 10) {
+        for (std::string input: {"random", "sorted", "reverse"}) {
+            auto keys = make_input(input, size);
+            run<std::set<int>>("std::set", input, keys);
+            if (input != "random" && size > kMaxChainSize) {
+                skip("BinaryTree<InOrder>", input, size);
+                skip("BinaryTree<PreOrder>", input, size);
+                skip("BinaryTree<PostOrder>", input, size);
+                continue;
+            }
+            run<BinaryTree<int, WalkType::InOrder>>("BinaryTree<InOrder>", input, keys);
+            run<BinaryTree<int, WalkType::PreOrder>>("BinaryTree<PreOrder>", input, keys);
+            run<BinaryTree<int, WalkType::PostOrder>>("BinaryTree<PostOrder>", input, keys);
+        }
+    }
+
+    FILE* out = out_path ? std::fopen(out_path, "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "can not open %s\n", out_path);
+        return 1;
+    }
+    std::fprintf(out, "[\n");
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& record = records[i];
+        std::fprintf(out, "  {\"container\": \"%s\", \"input\": \"%s\", \"size\": %zu, \"op\": \"%s\", ",
+                     record.container.c_str(), record.input.c_str(), record.size, record.op.c_str());
+        if (record.skipped) {
+            std::fprintf(out, "\"skipped\": true}");
+        } else {
+            std::fprintf(out, "\"ns_per_op\": %.2f}", record.ns_per_op);
+        }
+        std::fprintf(out, i + 1 == records.size() ? "\n" : ",\n");
+    }
+    std::fprintf(out, "]\n");
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    return 0;
+}
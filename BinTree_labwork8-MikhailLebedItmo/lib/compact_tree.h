@@ -0,0 +1,689 @@
+#pragma once
+#include "tree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// Node of CompactBinaryTree. Links are 32-bit slot indices, slot 0 is the end
+// node and doubles as "no node". The high bit of parent marks a free slot,
+// so up to 2^31 - 1 elements fit.
+template <typename T>
+struct CompactNode {
+    uint32_t left;
+    uint32_t right;
+    uint32_t parent;
+    alignas(T) unsigned char storage[sizeof(T)];
+
+    T& value() {
+        return *std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    const T& value() const {
+        return *std::launder(reinterpret_cast<const T*>(storage));
+    }
+};
+
+template <typename T, WalkType WT>
+class CompactBinaryTreeIterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    template <typename, WalkType, typename, typename>
+    friend class CompactBinaryTree;
+
+    CompactBinaryTreeIterator(): nodes(nullptr), current(0) {}
+
+    const T& operator*() const {
+        return node(current).value();
+    }
+
+    const T* operator->() const {
+        return &node(current).value();
+    }
+
+    CompactBinaryTreeIterator& operator++() {
+        current = next(current);
+        return *this;
+    }
+
+    CompactBinaryTreeIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    CompactBinaryTreeIterator& operator--() {
+        current = prev(current);
+        return *this;
+    }
+
+    CompactBinaryTreeIterator operator--(int) {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    friend bool operator==(const CompactBinaryTreeIterator& lhs, const CompactBinaryTreeIterator& rhs) {
+        return lhs.current == rhs.current;
+    }
+
+    friend bool operator!=(const CompactBinaryTreeIterator& lhs, const CompactBinaryTreeIterator& rhs) {
+        return lhs.current != rhs.current;
+    }
+private:
+    // points to the cell of the tree holding its array pointer: the cell
+    // follows the array when it grows and goes with it on swap and move,
+    // so none of these invalidates iterators
+    CompactNode<T>* const* nodes;
+    uint32_t current;
+
+    CompactBinaryTreeIterator(CompactNode<T>* const* nodes, uint32_t current)
+        : nodes(nodes), current(current) {}
+
+    const CompactNode<T>& node(uint32_t index) const {
+        return (*nodes)[index];
+    }
+
+    uint32_t parent(uint32_t index) const {
+        return node(index).parent;
+    }
+
+    uint32_t left(uint32_t index) const {
+        return node(index).left;
+    }
+
+    uint32_t right(uint32_t index) const {
+        return node(index).right;
+    }
+
+    // the first node of a subtree in the walk order
+    uint32_t first(uint32_t index) const {
+        if constexpr(WT == WalkType::InOrder) {
+            while (left(index)) {
+                index = left(index);
+            }
+        } else if constexpr(WT == WalkType::PostOrder) {
+            while (left(index) || right(index)) {
+                index = left(index) ? left(index) : right(index);
+            }
+        }
+        return index;
+    }
+
+    // the last node of a subtree in the walk order
+    uint32_t last(uint32_t index) const {
+        if constexpr(WT == WalkType::InOrder) {
+            while (right(index)) {
+                index = right(index);
+            }
+        } else if constexpr(WT == WalkType::PreOrder) {
+            while (left(index) || right(index)) {
+                index = right(index) ? right(index) : left(index);
+            }
+        }
+        return index;
+    }
+
+    uint32_t next(uint32_t index) const {
+        if constexpr(WT == WalkType::InOrder) {
+            if (right(index)) {
+                return first(right(index));
+            }
+            while (parent(index) && right(parent(index)) == index) {
+                index = parent(index);
+            }
+            return parent(index);
+        } else if constexpr(WT == WalkType::PreOrder) {
+            if (left(index)) {
+                return left(index);
+            }
+            if (right(index)) {
+                return right(index);
+            }
+            for (; parent(index); index = parent(index)) {
+                if (left(parent(index)) == index && right(parent(index))) {
+                    return right(parent(index));
+                }
+            }
+            return 0;
+        } else {
+            auto up = parent(index);
+            if (!up || right(up) == index || !right(up)) {
+                return up;
+            }
+            return first(right(up));
+        }
+    }
+
+    uint32_t prev(uint32_t index) const {
+        // the end node keeps the root in left
+        if (index == 0) {
+            return WT == WalkType::PostOrder ? left(0) : last(left(0));
+        }
+        if constexpr(WT == WalkType::InOrder) {
+            if (left(index)) {
+                return last(left(index));
+            }
+            while (parent(index) && left(parent(index)) == index) {
+                index = parent(index);
+            }
+            return parent(index);
+        } else if constexpr(WT == WalkType::PreOrder) {
+            auto up = parent(index);
+            if (!up || left(up) == index || !left(up)) {
+                return up;
+            }
+            return last(left(up));
+        } else {
+            if (right(index)) {
+                return right(index);
+            }
+            if (left(index)) {
+                return left(index);
+            }
+            for (; parent(index); index = parent(index)) {
+                if (right(parent(index)) == index && left(parent(index))) {
+                    return left(parent(index));
+                }
+            }
+            return 0;
+        }
+    }
+};
+
+// Same interface as BinaryTree, but nodes live in one growing array and link
+// by 32-bit indices: 12 bytes of links per element instead of three pointers
+// plus a heap block each. Erased slots are reused through a free list.
+// Iterators survive insertions, including growth of the array, and stay
+// with the elements on swap and move as with std::set.
+template <typename T,
+        WalkType WT = WalkType::InOrder,
+        typename Compare = std::less<T>,
+        typename Alloc = std::allocator<T>>
+class CompactBinaryTree {
+public:
+    friend void swap(CompactBinaryTree& left, CompactBinaryTree& right) {
+        left.swap(right);
+    }
+
+    using key_type = const T;
+    using value_type = const T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Alloc;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = CompactBinaryTreeIterator<T, WT>;
+    using const_iterator = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = reverse_iterator;
+    using node_type = CompactNode<T>;
+
+    explicit CompactBinaryTree(const Compare& comp = Compare(),
+                               const Alloc& alloc = Alloc())
+        : node_allocator_(alloc), compare_(comp), nodes_cell_(make_cell()) {}
+
+    explicit CompactBinaryTree(const Alloc& alloc)
+        : CompactBinaryTree(Compare(), alloc) {}
+
+    CompactBinaryTree(const CompactBinaryTree& other)
+        : node_allocator_(alloc_traits::select_on_container_copy_construction(other.node_allocator_))
+        , compare_(other.compare_)
+        , nodes_cell_(make_cell()) {
+        copy(other);
+    }
+
+    CompactBinaryTree(CompactBinaryTree&& other)
+        : CompactBinaryTree(other.compare_) {
+        swap(other);
+    }
+
+    template<typename InputIterator>
+    CompactBinaryTree(InputIterator first,
+                      InputIterator last,
+                      const Compare& comp = Compare(),
+                      const Alloc& alloc = Alloc())
+        : CompactBinaryTree(comp, alloc) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    CompactBinaryTree(std::initializer_list<T> init,
+                      const Compare& comp = Compare(),
+                      const Alloc& alloc = Alloc())
+        : CompactBinaryTree(init.begin(), init.end(), comp, alloc) {}
+
+    CompactBinaryTree& operator=(CompactBinaryTree other) {
+        swap(other);
+        return *this;
+    }
+
+    ~CompactBinaryTree() {
+        clear();
+        if (nodes_) {
+            alloc_traits::deallocate(node_allocator_, nodes_, capacity_);
+        }
+        cell_allocator_type cell_allocator(node_allocator_);
+        cell_alloc_traits::deallocate(cell_allocator, nodes_cell_, 1);
+    }
+
+    iterator begin() const {
+        return make_iterator(size_ == 0 ? 0 : end_node().right);
+    }
+
+    iterator end() const {
+        return make_iterator(0);
+    }
+
+    iterator cbegin() const {
+        return begin();
+    }
+
+    iterator cend() const {
+        return end();
+    }
+
+    reverse_iterator rbegin() const {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() const {
+        return reverse_iterator(begin());
+    }
+
+    bool operator==(const CompactBinaryTree& other) const {
+        if (size_ != other.size_) {
+            return false;
+        }
+
+        return std::equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(const CompactBinaryTree& other) const {
+        return !(*this == other);
+    }
+
+    std::pair<iterator, bool> insert(const_reference value) {
+        uint32_t parent = 0;
+        bool to_left = true;
+        for (uint32_t cur = root(); cur; ) {
+            parent = cur;
+            if (compare_(value, value_of(cur))) {
+                to_left = true;
+                cur = nodes_[cur].left;
+            } else if (compare_(value_of(cur), value)) {
+                to_left = false;
+                cur = nodes_[cur].right;
+            } else {
+                return {make_iterator(cur), false};
+            }
+        }
+        // slots may move, so the new slot is taken before linking
+        uint32_t index = allocate_slot(value);
+        nodes_[index].parent = parent;
+        if (to_left) {
+            nodes_[parent].left = index;
+        } else {
+            nodes_[parent].right = index;
+        }
+        ++size_;
+        update_begin();
+
+        return {make_iterator(index), true};
+    }
+
+    iterator insert(const_iterator, const_reference value) {
+        return insert(value).first;
+    }
+
+    const_iterator find(const_reference key) const {
+        return make_iterator(find_index(key));
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    const_iterator find(const K& key) const {
+        return make_iterator(find_index(key));
+    }
+
+    const_iterator lower_bound(const_reference key) const {
+        return make_iterator(lower_bound_index(key));
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    const_iterator lower_bound(const K& key) const {
+        return make_iterator(lower_bound_index(key));
+    }
+
+    const_iterator upper_bound(const_reference key) const {
+        return make_iterator(upper_bound_index(key));
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    const_iterator upper_bound(const K& key) const {
+        return make_iterator(upper_bound_index(key));
+    }
+
+    size_t count(const_reference key) const {
+        return find_index(key) != 0;
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    size_t count(const K& key) const {
+        return find_index(key) != 0;
+    }
+
+    bool contains(const_reference key) const {
+        return find_index(key) != 0;
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    bool contains(const K& key) const {
+        return find_index(key) != 0;
+    }
+
+    size_t erase(const_reference key) {
+        auto index = find_index(key);
+        if (index == 0) {
+            return 0;
+        }
+        erase(make_iterator(index));
+
+        return 1;
+    }
+
+    iterator erase(iterator it) {
+        auto response = it;
+        ++response;
+        // the successor takes the place of a node with two children in
+        // every walk, so it is the element after the erased one
+        auto& node = nodes_[it.current];
+        if (node.left && node.right) {
+            response.current = node.right;
+            while (nodes_[response.current].left) {
+                response.current = nodes_[response.current].left;
+            }
+        }
+        cut(it.current);
+        free_slot(it.current);
+        --size_;
+        update_begin();
+
+        return response;
+    }
+
+    void merge(CompactBinaryTree& other) {
+        auto it = other.begin();
+        while (it != other.end()) {
+            insert(*it);
+            it = other.erase(it);
+        }
+    }
+
+    void swap(CompactBinaryTree& other) {
+        using std::swap;
+        swap(node_allocator_, other.node_allocator_);
+        swap(compare_, other.compare_);
+        swap(nodes_, other.nodes_);
+        swap(nodes_cell_, other.nodes_cell_);
+        swap(capacity_, other.capacity_);
+        swap(used_, other.used_);
+        swap(free_, other.free_);
+        swap(size_, other.size_);
+    }
+
+    size_type size() const {
+        return size_;
+    }
+
+    size_type max_size() const {
+        return kFree - 1;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    key_compare key_comp() const {
+        return compare_;
+    }
+
+    value_compare value_comp() const {
+        return compare_;
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(node_allocator_);
+    }
+
+    // keeps the array for reuse
+    void clear() {
+        for (uint32_t index = 1; index < used_; ++index) {
+            if (!(nodes_[index].parent & kFree)) {
+                std::destroy_at(&nodes_[index].value());
+            }
+        }
+        if (nodes_) {
+            nodes_[0] = {0, 0, 0, {}};
+        }
+        used_ = nodes_ ? 1 : 0;
+        free_ = 0;
+        size_ = 0;
+    }
+
+private:
+    using node_allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<node_type>;
+    using alloc_traits = std::allocator_traits<node_allocator_type>;
+    using cell_allocator_type = typename alloc_traits::template rebind_alloc<node_type*>;
+    using cell_alloc_traits = std::allocator_traits<cell_allocator_type>;
+
+    static constexpr uint32_t kFree = uint32_t(1) << 31;
+
+    node_allocator_type node_allocator_;
+    Compare compare_;
+    node_type* nodes_ = nullptr;
+    // holds nodes_ for the iterators, allocated once per tree
+    node_type** nodes_cell_;
+    uint32_t capacity_ = 0;
+    // slots below used_ were handed out at least once
+    uint32_t used_ = 0;
+    // head of the free list, linked through left
+    uint32_t free_ = 0;
+    size_t size_ = 0;
+
+    iterator make_iterator(uint32_t index) const {
+        return iterator(nodes_cell_, index);
+    }
+
+    node_type** make_cell() {
+        cell_allocator_type cell_allocator(node_allocator_);
+        node_type** cell = cell_alloc_traits::allocate(cell_allocator, 1);
+        cell_alloc_traits::construct(cell_allocator, cell, nullptr);
+        return cell;
+    }
+
+    const node_type& end_node() const {
+        return nodes_[0];
+    }
+
+    uint32_t root() const {
+        return nodes_ ? nodes_[0].left : 0;
+    }
+
+    const T& value_of(uint32_t index) const {
+        return nodes_[index].value();
+    }
+
+    // the end node keeps the root in left and begin in right
+    void update_begin() {
+        if (size_ != 0) {
+            nodes_[0].right = make_iterator(0).first(root());
+        }
+    }
+
+    void reserve(uint32_t capacity) {
+        node_type* nodes = alloc_traits::allocate(node_allocator_, capacity);
+        for (uint32_t index = 0; index < used_; ++index) {
+            auto& from = nodes_[index];
+            auto& to = nodes[index];
+            to.left = from.left;
+            to.right = from.right;
+            to.parent = from.parent;
+            if (index != 0 && !(from.parent & kFree)) {
+                std::construct_at(reinterpret_cast<T*>(to.storage), std::move(from.value()));
+                std::destroy_at(&from.value());
+            }
+        }
+        if (nodes_) {
+            alloc_traits::deallocate(node_allocator_, nodes_, capacity_);
+        } else {
+            nodes[0] = {0, 0, 0, {}};
+            used_ = 1;
+        }
+        nodes_ = nodes;
+        *nodes_cell_ = nodes;
+        capacity_ = capacity;
+    }
+
+    uint32_t allocate_slot(const T& value) {
+        uint32_t index = free_;
+        if (index != 0) {
+            free_ = nodes_[index].left;
+        } else {
+            if (used_ == capacity_) {
+                // indices stay below kFree, doubling would also wrap past 2^31
+                if (capacity_ == kFree) {
+                    throw std::length_error("CompactBinaryTree is full");
+                }
+                reserve(capacity_ == 0 ? 16 : std::min(capacity_, kFree / 2) * 2);
+            }
+            index = used_++;
+        }
+        std::construct_at(reinterpret_cast<T*>(nodes_[index].storage), value);
+        nodes_[index].left = 0;
+        nodes_[index].right = 0;
+        nodes_[index].parent = 0;
+
+        return index;
+    }
+
+    void free_slot(uint32_t index) {
+        std::destroy_at(&nodes_[index].value());
+        nodes_[index].parent = kFree;
+        nodes_[index].left = free_;
+        free_ = index;
+    }
+
+    void replace_child(uint32_t parent, uint32_t old_child, uint32_t new_child) {
+        if (nodes_[parent].left == old_child) {
+            nodes_[parent].left = new_child;
+        } else {
+            nodes_[parent].right = new_child;
+        }
+        if (new_child) {
+            nodes_[new_child].parent = parent;
+        }
+    }
+
+    // unlinks a node, a node with two children is replaced by its successor
+    void cut(uint32_t index) {
+        auto& node = nodes_[index];
+        if (!node.left || !node.right) {
+            replace_child(node.parent, index, node.left ? node.left : node.right);
+            return;
+        }
+        uint32_t next = node.right;
+        while (nodes_[next].left) {
+            next = nodes_[next].left;
+        }
+        if (next != node.right) {
+            replace_child(nodes_[next].parent, next, nodes_[next].right);
+            nodes_[next].right = node.right;
+            nodes_[node.right].parent = next;
+        }
+        nodes_[next].left = node.left;
+        nodes_[node.left].parent = next;
+        replace_child(node.parent, index, next);
+    }
+
+    template <typename K>
+    uint32_t find_index(const K& key) const {
+        uint32_t cur = root();
+        while (cur) {
+            if (compare_(key, value_of(cur))) {
+                cur = nodes_[cur].left;
+            } else if (compare_(value_of(cur), key)) {
+                cur = nodes_[cur].right;
+            } else {
+                return cur;
+            }
+        }
+
+        return 0;
+    }
+
+    template <typename K>
+    uint32_t lower_bound_index(const K& key) const {
+        uint32_t response = 0;
+        for (uint32_t cur = root(); cur; ) {
+            if (compare_(value_of(cur), key)) {
+                cur = nodes_[cur].right;
+            } else {
+                response = cur;
+                cur = nodes_[cur].left;
+            }
+        }
+
+        return response;
+    }
+
+    template <typename K>
+    uint32_t upper_bound_index(const K& key) const {
+        uint32_t response = 0;
+        for (uint32_t cur = root(); cur; ) {
+            if (compare_(key, value_of(cur))) {
+                response = cur;
+                cur = nodes_[cur].left;
+            } else {
+                cur = nodes_[cur].right;
+            }
+        }
+
+        return response;
+    }
+
+    // slot by slot, so the copy has the same shape and indices
+    void copy(const CompactBinaryTree& other) {
+        if (!other.nodes_) {
+            return;
+        }
+        nodes_ = alloc_traits::allocate(node_allocator_, other.used_);
+        *nodes_cell_ = nodes_;
+        capacity_ = other.used_;
+        for (uint32_t index = 0; index < other.used_; ++index) {
+            auto& from = other.nodes_[index];
+            auto& to = nodes_[index];
+            to.left = from.left;
+            to.right = from.right;
+            to.parent = from.parent;
+            if (index != 0 && !(from.parent & kFree)) {
+                std::construct_at(reinterpret_cast<T*>(to.storage), from.value());
+            }
+        }
+        used_ = other.used_;
+        free_ = other.free_;
+        size_ = other.size_;
+    }
+};
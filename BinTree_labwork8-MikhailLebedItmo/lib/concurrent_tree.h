@@ -0,0 +1,426 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Epoch based reclamation: readers pin the current epoch while they hold raw
+// node pointers, writers free a retired node only when every pinned epoch is
+// newer than the epoch the node was retired in.
+class EpochDomain {
+public:
+    static constexpr size_t kSlots = 128;
+    static constexpr uint64_t kIdle = UINT64_MAX;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{kIdle};
+        std::atomic<bool> busy{false};
+    };
+
+public:
+    class Guard {
+    public:
+        explicit Guard(EpochDomain& domain): slot_(domain.acquire_slot()) {
+            slot_->epoch.store(domain.global_epoch_.load());
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            slot_->epoch.store(kIdle, std::memory_order_release);
+            slot_->busy.store(false, std::memory_order_release);
+        }
+    private:
+        Slot* slot_;
+    };
+
+    Guard pin() {
+        return Guard(*this);
+    }
+
+    // returns the epoch in which an already unlinked object is retired
+    uint64_t advance() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return global_epoch_.fetch_add(1);
+    }
+
+    // every object retired in an epoch less than the result is unreachable
+    uint64_t min_active() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t result = global_epoch_.load();
+        for (const auto& slot: slots_) {
+            auto epoch = slot.epoch.load();
+            if (epoch < result) {
+                result = epoch;
+            }
+        }
+
+        return result;
+    }
+
+private:
+    std::atomic<uint64_t> global_epoch_{0};
+    Slot slots_[kSlots];
+
+    Slot* acquire_slot() {
+        size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % kSlots;
+        while (true) {
+            for (size_t i = 0; i < kSlots; ++i) {
+                auto& slot = slots_[(start + i) % kSlots];
+                bool expected = false;
+                if (!slot.busy.load(std::memory_order_relaxed) &&
+                        slot.busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    return &slot;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+};
+
+struct ConcurrentBaseNode {
+    std::atomic<ConcurrentBaseNode*> left = nullptr;
+    std::atomic<ConcurrentBaseNode*> right = nullptr;
+    // erased, but may still route searches if it had two children
+    std::atomic<bool> deleted = false;
+    // detached from the tree, waits for reclamation
+    std::atomic<bool> unlinked = false;
+    std::mutex lock;
+    ConcurrentBaseNode* retired_next = nullptr;
+    uint64_t retire_epoch = 0;
+
+    std::atomic<ConcurrentBaseNode*>& child(bool is_left) {
+        return is_left ? left : right;
+    }
+};
+
+template <typename T>
+struct ConcurrentNode : ConcurrentBaseNode {
+    const T value;
+
+    ConcurrentNode(const T& value): ConcurrentBaseNode(), value(value) {}
+};
+
+// Set with lock-free readers. find/lower_bound/for_each never take locks,
+// writers lock only the parent (insert) or the parent and the node (erase).
+// An erased node with two children stays in the tree as a routing node
+// and is unlinked once it has at most one child left.
+template <typename T,
+        typename Compare = std::less<T>,
+        typename Alloc = std::allocator<T>>
+class ConcurrentBinaryTree {
+public:
+    using key_type = const T;
+    using value_type = const T;
+    using size_type = size_t;
+    using key_compare = Compare;
+    using allocator_type = Alloc;
+    using const_reference = const T&;
+
+    explicit ConcurrentBinaryTree(const Compare& comp = Compare(),
+                                  const Alloc& alloc = Alloc())
+        : compare_(comp), node_allocator_(alloc) {}
+
+    ConcurrentBinaryTree(std::initializer_list<T> init,
+                         const Compare& comp = Compare(),
+                         const Alloc& alloc = Alloc())
+        : ConcurrentBinaryTree(comp, alloc) {
+        for (const auto& value: init) {
+            insert(value);
+        }
+    }
+
+    ConcurrentBinaryTree(const ConcurrentBinaryTree&) = delete;
+    ConcurrentBinaryTree& operator=(const ConcurrentBinaryTree&) = delete;
+
+    ~ConcurrentBinaryTree() {
+        recursive_free(head_.left.load());
+        collect(EpochDomain::kIdle);
+    }
+
+    bool insert(const_reference value) {
+        while (true) {
+            auto guard = epoch_.pin();
+            ConcurrentBaseNode* parent = &head_;
+            bool is_left = true;
+            ConcurrentBaseNode* node = head_.left.load(std::memory_order_acquire);
+            while (node) {
+                const auto& cur_value = value_of(node);
+                if (compare_(value, cur_value)) {
+                    parent = node;
+                    is_left = true;
+                } else if (compare_(cur_value, value)) {
+                    parent = node;
+                    is_left = false;
+                } else {
+                    break;
+                }
+                node = parent->child(is_left).load(std::memory_order_acquire);
+            }
+
+            if (node) {
+                if (!node->deleted.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                std::lock_guard node_lock(node->lock);
+                if (node->unlinked.load()) {
+                    continue;
+                }
+                if (!node->deleted.load()) {
+                    return false;
+                }
+                node->deleted.store(false, std::memory_order_release);
+                size_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            std::lock_guard parent_lock(parent->lock);
+            if (parent->unlinked.load() || parent->child(is_left).load() != nullptr) {
+                continue;
+            }
+            ConcurrentNode<T>* new_node = alloc_traits::allocate(node_allocator_, 1);
+            alloc_traits::construct(node_allocator_, new_node, value);
+            parent->child(is_left).store(new_node, std::memory_order_release);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    bool erase(const_reference value) {
+        while (true) {
+            auto guard = epoch_.pin();
+            ConcurrentBaseNode* grand_parent = nullptr;
+            bool parent_is_left = true;
+            ConcurrentBaseNode* parent = &head_;
+            bool is_left = true;
+            ConcurrentBaseNode* node = head_.left.load(std::memory_order_acquire);
+            while (node) {
+                const auto& cur_value = value_of(node);
+                bool go_left;
+                if (compare_(value, cur_value)) {
+                    go_left = true;
+                } else if (compare_(cur_value, value)) {
+                    go_left = false;
+                } else {
+                    break;
+                }
+                grand_parent = parent;
+                parent_is_left = is_left;
+                parent = node;
+                is_left = go_left;
+                node = parent->child(is_left).load(std::memory_order_acquire);
+            }
+            if (!node || node->deleted.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            bool unlinked;
+            {
+                std::scoped_lock locks(parent->lock, node->lock);
+                if (!valid_link(parent, is_left, node)) {
+                    continue;
+                }
+                if (node->deleted.load()) {
+                    return false;
+                }
+                node->deleted.store(true, std::memory_order_release);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                unlinked = try_splice(parent, is_left, node);
+            }
+            if (unlinked && grand_parent && parent->deleted.load()) {
+                std::scoped_lock locks(grand_parent->lock, parent->lock);
+                if (valid_link(grand_parent, parent_is_left, parent) && parent->deleted.load()) {
+                    try_splice(grand_parent, parent_is_left, parent);
+                }
+            }
+
+            return true;
+        }
+    }
+
+    bool contains(const_reference value) const {
+        auto guard = epoch_.pin();
+        return find_node(value) != nullptr;
+    }
+
+    std::optional<T> find(const_reference value) const {
+        auto guard = epoch_.pin();
+        auto node = find_node(value);
+        if (!node) {
+            return std::nullopt;
+        }
+
+        return value_of(node);
+    }
+
+    std::optional<T> lower_bound(const_reference value) const {
+        auto guard = epoch_.pin();
+        auto node = first_live(head_.left.load(std::memory_order_acquire), [&](const T& cur_value) {
+            return !compare_(cur_value, value);
+        });
+        if (!node) {
+            return std::nullopt;
+        }
+
+        return value_of(node);
+    }
+
+    std::optional<T> upper_bound(const_reference value) const {
+        auto guard = epoch_.pin();
+        auto node = first_live(head_.left.load(std::memory_order_acquire), [&](const T& cur_value) {
+            return compare_(value, cur_value);
+        });
+        if (!node) {
+            return std::nullopt;
+        }
+
+        return value_of(node);
+    }
+
+    // in-order walk without locks; sees every element present for the whole walk
+    template <typename Func>
+    void for_each(Func func) const {
+        auto guard = epoch_.pin();
+        recursive_walk(head_.left.load(std::memory_order_acquire), func);
+    }
+
+    size_type size() const {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    key_compare key_comp() const {
+        return compare_;
+    }
+
+private:
+    using node_allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<ConcurrentNode<T>>;
+    using alloc_traits = std::allocator_traits<node_allocator_type>;
+    static constexpr size_t kCollectPeriod = 64;
+
+    Compare compare_;
+    node_allocator_type node_allocator_;
+    // root is head_.left, head_ itself never holds a value
+    ConcurrentBaseNode head_;
+    std::atomic<size_t> size_ = 0;
+    mutable EpochDomain epoch_;
+    std::mutex retire_lock_;
+    ConcurrentBaseNode* retired_ = nullptr;
+    size_t retired_count_ = 0;
+
+    static const T& value_of(const ConcurrentBaseNode* node) {
+        return static_cast<const ConcurrentNode<T>*>(node)->value;
+    }
+
+    static bool valid_link(ConcurrentBaseNode* parent, bool is_left, ConcurrentBaseNode* node) {
+        return !parent->unlinked.load() && !node->unlinked.load() && parent->child(is_left).load() == node;
+    }
+
+    // both parent and node must be locked; unlinks node if it has at most one child
+    bool try_splice(ConcurrentBaseNode* parent, bool is_left, ConcurrentBaseNode* node) {
+        auto left = node->left.load();
+        auto right = node->right.load();
+        if (left && right) {
+            return false;
+        }
+        node->unlinked.store(true);
+        parent->child(is_left).store(left ? left : right, std::memory_order_release);
+        retire(node);
+
+        return true;
+    }
+
+    const ConcurrentBaseNode* find_node(const_reference value) const {
+        const ConcurrentBaseNode* node = head_.left.load(std::memory_order_acquire);
+        while (node) {
+            const auto& cur_value = value_of(node);
+            if (compare_(value, cur_value)) {
+                node = node->left.load(std::memory_order_acquire);
+            } else if (compare_(cur_value, value)) {
+                node = node->right.load(std::memory_order_acquire);
+            } else {
+                return node->deleted.load(std::memory_order_acquire) ? nullptr : node;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // leftmost live node satisfying the monotone predicate
+    template <typename Pred>
+    const ConcurrentBaseNode* first_live(const ConcurrentBaseNode* node, const Pred& pred) const {
+        while (node && !pred(value_of(node))) {
+            node = node->right.load(std::memory_order_acquire);
+        }
+        if (!node) {
+            return nullptr;
+        }
+        if (auto left = first_live(node->left.load(std::memory_order_acquire), pred)) {
+            return left;
+        }
+        if (!node->deleted.load(std::memory_order_acquire)) {
+            return node;
+        }
+
+        return first_live(node->right.load(std::memory_order_acquire), pred);
+    }
+
+    template <typename Func>
+    static void recursive_walk(const ConcurrentBaseNode* node, Func& func) {
+        if (!node) {
+            return;
+        }
+        recursive_walk(node->left.load(std::memory_order_acquire), func);
+        if (!node->deleted.load(std::memory_order_acquire)) {
+            func(value_of(node));
+        }
+        recursive_walk(node->right.load(std::memory_order_acquire), func);
+    }
+
+    void retire(ConcurrentBaseNode* node) {
+        std::lock_guard retire_lock(retire_lock_);
+        node->retire_epoch = epoch_.advance();
+        node->retired_next = retired_;
+        retired_ = node;
+        if (++retired_count_ % kCollectPeriod == 0) {
+            collect(epoch_.min_active());
+        }
+    }
+
+    // retire_lock_ must be held, or the tree must be unreachable
+    void collect(uint64_t min_active) {
+        ConcurrentBaseNode** link = &retired_;
+        while (*link) {
+            auto node = *link;
+            if (node->retire_epoch < min_active) {
+                *link = node->retired_next;
+                free_node(node);
+            } else {
+                link = &node->retired_next;
+            }
+        }
+    }
+
+    void free_node(ConcurrentBaseNode* node) {
+        alloc_traits::destroy(node_allocator_, static_cast<ConcurrentNode<T>*>(node));
+        alloc_traits::deallocate(node_allocator_, static_cast<ConcurrentNode<T>*>(node), 1);
+    }
+
+    void recursive_free(ConcurrentBaseNode* node) {
+        if (!node) {
+            return;
+        }
+        recursive_free(node->left.load());
+        recursive_free(node->right.load());
+        free_node(node);
+    }
+};
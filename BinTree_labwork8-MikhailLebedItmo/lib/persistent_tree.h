@@ -0,0 +1,389 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+template <typename T>
+struct PersistentNode {
+    using pointer = std::shared_ptr<const PersistentNode>;
+
+    T value;
+    uint64_t priority;
+    pointer left;
+    pointer right;
+
+    PersistentNode(const T& value, uint64_t priority, pointer left, pointer right)
+        : value(value), priority(priority), left(std::move(left)), right(std::move(right)) {}
+};
+
+template <typename T, typename Compare>
+class PersistentBinaryTreeIterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    PersistentBinaryTreeIterator(): root(nullptr), current(nullptr), compare(nullptr) {}
+
+    PersistentBinaryTreeIterator(const PersistentNode<T>* root,
+                                 const PersistentNode<T>* current,
+                                 const Compare* compare)
+        : root(root), current(current), compare(compare) {}
+
+    reference operator*() const {
+        return current->value;
+    }
+
+    pointer operator->() const {
+        return &current->value;
+    }
+
+    // nodes have no parent links since they are shared between versions,
+    // so neighbours are searched from the root of the version
+    PersistentBinaryTreeIterator& operator++() {
+        const PersistentNode<T>* next = nullptr;
+        auto node = root;
+        while (node) {
+            if ((*compare)(current->value, node->value)) {
+                next = node;
+                node = node->left.get();
+            } else {
+                node = node->right.get();
+            }
+        }
+        current = next;
+        return *this;
+    }
+
+    PersistentBinaryTreeIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    PersistentBinaryTreeIterator& operator--() {
+        const PersistentNode<T>* prev = nullptr;
+        auto node = root;
+        while (node) {
+            if (!current || (*compare)(node->value, current->value)) {
+                prev = node;
+                node = node->right.get();
+            } else {
+                node = node->left.get();
+            }
+        }
+        current = prev;
+        return *this;
+    }
+
+    PersistentBinaryTreeIterator operator--(int) {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    friend bool operator==(const PersistentBinaryTreeIterator& lhs, const PersistentBinaryTreeIterator& rhs) {
+        return lhs.current == rhs.current;
+    }
+
+    friend bool operator!=(const PersistentBinaryTreeIterator& lhs, const PersistentBinaryTreeIterator& rhs) {
+        return lhs.current != rhs.current;
+    }
+private:
+    const PersistentNode<T>* root;
+    const PersistentNode<T>* current;
+    const Compare* compare;
+};
+
+// Immutable set with structural sharing. insert/erase leave the tree as is
+// and return a new version that copies only the O(log n) nodes on the
+// search path (the tree is a treap, so the path is short in expectation).
+// Versions own their nodes through reference counts, so a snapshot is
+// one pointer copy and nodes die with the last version that uses them.
+template <typename T,
+        typename Compare = std::less<T>,
+        typename Alloc = std::allocator<T>>
+class PersistentBinaryTree {
+public:
+    using key_type = const T;
+    using value_type = const T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Alloc;
+    using reference = const T&;
+    using const_reference = const T&;
+    using iterator = PersistentBinaryTreeIterator<T, Compare>;
+    using const_iterator = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = reverse_iterator;
+
+    explicit PersistentBinaryTree(const Compare& comp = Compare(),
+                                  const Alloc& alloc = Alloc())
+        : compare_(comp), allocator_(alloc), size_(0) {}
+
+    PersistentBinaryTree(std::initializer_list<T> init,
+                         const Compare& comp = Compare(),
+                         const Alloc& alloc = Alloc())
+        : PersistentBinaryTree(comp, alloc) {
+        for (const auto& value: init) {
+            *this = insert(value);
+        }
+    }
+
+    PersistentBinaryTree snapshot() const {
+        return *this;
+    }
+
+    iterator begin() const {
+        auto node = root_.get();
+        while (node && node->left) {
+            node = node->left.get();
+        }
+        return iterator(root_.get(), node, &compare_);
+    }
+
+    iterator end() const {
+        return iterator(root_.get(), nullptr, &compare_);
+    }
+
+    iterator cbegin() const {
+        return begin();
+    }
+
+    iterator cend() const {
+        return end();
+    }
+
+    reverse_iterator rbegin() const {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() const {
+        return reverse_iterator(begin());
+    }
+
+    bool operator==(const PersistentBinaryTree& other) const {
+        if (size_ != other.size_) {
+            return false;
+        }
+        if (root_ == other.root_) {
+            return true;
+        }
+
+        return std::equal(begin(), end(), other.begin());
+    }
+
+    bool operator!=(const PersistentBinaryTree& other) const {
+        return !(*this == other);
+    }
+
+    PersistentBinaryTree insert(const_reference value) const {
+        if (contains(value)) {
+            return *this;
+        }
+        PersistentBinaryTree result = *this;
+        result.root_ = insert(root_, value, next_priority());
+        ++result.size_;
+
+        return result;
+    }
+
+    PersistentBinaryTree erase(const_reference value) const {
+        auto new_root = erase(root_, value);
+        if (new_root == root_) {
+            return *this;
+        }
+        PersistentBinaryTree result = *this;
+        result.root_ = std::move(new_root);
+        --result.size_;
+
+        return result;
+    }
+
+    const_iterator find(const_reference value) const {
+        auto node = root_.get();
+        while (node) {
+            if (compare_(value, node->value)) {
+                node = node->left.get();
+            } else if (compare_(node->value, value)) {
+                node = node->right.get();
+            } else {
+                break;
+            }
+        }
+
+        return iterator(root_.get(), node, &compare_);
+    }
+
+    const_iterator lower_bound(const_reference value) const {
+        const PersistentNode<T>* response = nullptr;
+        auto node = root_.get();
+        while (node) {
+            if (compare_(node->value, value)) {
+                node = node->right.get();
+            } else {
+                response = node;
+                node = node->left.get();
+            }
+        }
+
+        return iterator(root_.get(), response, &compare_);
+    }
+
+    const_iterator upper_bound(const_reference value) const {
+        const PersistentNode<T>* response = nullptr;
+        auto node = root_.get();
+        while (node) {
+            if (compare_(value, node->value)) {
+                response = node;
+                node = node->left.get();
+            } else {
+                node = node->right.get();
+            }
+        }
+
+        return iterator(root_.get(), response, &compare_);
+    }
+
+    size_t count(const_reference value) const {
+        return find(value) != end();
+    }
+
+    bool contains(const_reference value) const {
+        return count(value);
+    }
+
+    void swap(PersistentBinaryTree& other) {
+        using std::swap;
+        swap(compare_, other.compare_);
+        swap(allocator_, other.allocator_);
+        swap(root_, other.root_);
+        swap(size_, other.size_);
+    }
+
+    friend void swap(PersistentBinaryTree& left, PersistentBinaryTree& right) {
+        left.swap(right);
+    }
+
+    size_type size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    key_compare key_comp() const {
+        return compare_;
+    }
+
+    value_compare value_comp() const {
+        return compare_;
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_;
+    }
+
+    void clear() {
+        root_.reset();
+        size_ = 0;
+    }
+
+private:
+    using node_type = PersistentNode<T>;
+    using node_pointer = typename node_type::pointer;
+
+    Compare compare_;
+    Alloc allocator_;
+    node_pointer root_;
+    size_t size_;
+
+    static uint64_t next_priority() {
+        static thread_local uint64_t seed = 0x9E3779B97F4A7C15ull ^
+                std::hash<const void*>()(&seed);
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    }
+
+    node_pointer make_node(const T& value, uint64_t priority, node_pointer left, node_pointer right) const {
+        return std::allocate_shared<node_type>(allocator_, value, priority,
+                                               std::move(left), std::move(right));
+    }
+
+    // value must be absent from the subtree
+    node_pointer insert(const node_pointer& node, const T& value, uint64_t priority) const {
+        if (!node) {
+            return make_node(value, priority, nullptr, nullptr);
+        }
+        if (priority > node->priority) {
+            auto [left, right] = split(node, value);
+            return make_node(value, priority, std::move(left), std::move(right));
+        }
+        if (compare_(value, node->value)) {
+            return make_node(node->value, node->priority, insert(node->left, value, priority), node->right);
+        }
+
+        return make_node(node->value, node->priority, node->left, insert(node->right, value, priority));
+    }
+
+    node_pointer erase(const node_pointer& node, const T& value) const {
+        if (!node) {
+            return node;
+        }
+        if (compare_(value, node->value)) {
+            auto left = erase(node->left, value);
+            if (left == node->left) {
+                return node;
+            }
+            return make_node(node->value, node->priority, std::move(left), node->right);
+        }
+        if (compare_(node->value, value)) {
+            auto right = erase(node->right, value);
+            if (right == node->right) {
+                return node;
+            }
+            return make_node(node->value, node->priority, node->left, std::move(right));
+        }
+
+        return join(node->left, node->right);
+    }
+
+    // splits by a value that is absent from the subtree
+    std::pair<node_pointer, node_pointer> split(const node_pointer& node, const T& value) const {
+        if (!node) {
+            return {nullptr, nullptr};
+        }
+        if (compare_(value, node->value)) {
+            auto [left, right] = split(node->left, value);
+            return {std::move(left), make_node(node->value, node->priority, std::move(right), node->right)};
+        }
+        auto [left, right] = split(node->right, value);
+
+        return {make_node(node->value, node->priority, node->left, std::move(left)), std::move(right)};
+    }
+
+    // every value of left is less than every value of right
+    node_pointer join(const node_pointer& left, const node_pointer& right) const {
+        if (!left) {
+            return right;
+        }
+        if (!right) {
+            return left;
+        }
+        if (left->priority > right->priority) {
+            return make_node(left->value, left->priority, left->left, join(left->right, right));
+        }
+
+        return make_node(right->value, right->priority, join(left, right->left), right->right);
+    }
+};
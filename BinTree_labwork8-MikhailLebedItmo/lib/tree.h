@@ -3,6 +3,16 @@
 #include <iterator>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <functional>
 
 enum class WalkType {
     PreOrder,
@@ -13,39 +23,262 @@ enum class WalkType {
 template <typename T, WalkType WT>
 class BinaryTreeIterator;
 
+template <typename T>
+class ThreadedBinaryTreeIterator;
+
 struct BaseNode {
     BaseNode* left = nullptr;
     BaseNode* right = nullptr;
     BaseNode* parent = nullptr;
 };
 
-template <typename T>
+// links to the neighbours in the walk order of the tree, the end node
+// closes them into a ring
+struct ThreadedBaseNode : BaseNode {
+    BaseNode* next = nullptr;
+    BaseNode* prev = nullptr;
+};
+
+template <typename T, typename Base = BaseNode>
 struct Node;
 
+template <typename T, typename Base, typename Augment>
+struct AugmentedNode;
+
+// Default augmentation, nodes keep no summary.
+struct NoAugment {};
+
+// Intervals [first, second] ordered by start, a subtree keeps its largest end.
+template <typename Endpoint>
+struct IntervalAugment {
+    using endpoint_type = Endpoint;
+    using summary_type = Endpoint;
+
+    static Endpoint make(const std::pair<Endpoint, Endpoint>& interval) {
+        return interval.second;
+    }
+
+    static Endpoint combine(const Endpoint& left, const Endpoint& right) {
+        return std::max(left, right);
+    }
+};
+
+// A subtree keeps Combine folded over its values (mapped values for maps)
+// in key order. Combine has to be associative but not commutative.
+template <typename Value, typename Combine = std::plus<Value>>
+struct MonoidAugment {
+    using summary_type = Value;
+
+    static Value make(const Value& value) {
+        return value;
+    }
+
+    template <typename Key>
+    static Value make(const std::pair<const Key, Value>& value) {
+        return value.second;
+    }
+
+    static Value combine(const Value& left, const Value& right) {
+        return Combine()(left, right);
+    }
+};
+
+// Operation costs counted by a tree with StatsTraits since construction
+// or the last reset_stats(). relinks counts subtrees moved to another
+// parent by erase, split and join: the tree is not balanced and has no
+// rotations, so these are its only restructurings.
+struct OperationStats {
+    size_t comparisons = 0;
+    size_t node_visits = 0;
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t relinks = 0;
+};
+
+// Default stats policy, every call is empty and the member takes no space,
+// so a tree without stats compiles to the same code as before.
+struct NoStats {
+    void compare() {}
+    void visit() {}
+    void allocate() {}
+    void deallocate() {}
+    void relink() {}
+    void reset() {}
+
+    OperationStats get() const {
+        return {};
+    }
+};
+
+// Counters are relaxed atomics since set operations and the parallel
+// walks touch them from several threads.
+struct CountingStats {
+    std::atomic<size_t> comparisons = 0;
+    std::atomic<size_t> node_visits = 0;
+    std::atomic<size_t> allocations = 0;
+    std::atomic<size_t> deallocations = 0;
+    std::atomic<size_t> relinks = 0;
+
+    void compare() {
+        comparisons.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void visit() {
+        node_visits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void allocate() {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void deallocate() {
+        deallocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void relink() {
+        relinks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        comparisons = 0;
+        node_visits = 0;
+        allocations = 0;
+        deallocations = 0;
+        relinks = 0;
+    }
+
+    OperationStats get() const {
+        return {comparisons.load(std::memory_order_relaxed), node_visits.load(std::memory_order_relaxed),
+                allocations.load(std::memory_order_relaxed), deallocations.load(std::memory_order_relaxed),
+                relinks.load(std::memory_order_relaxed)};
+    }
+};
+
+// Shape of a tree as reported by shape_stats(). The root has depth 0,
+// balance[i] counts nodes whose subtree heights differ by i, the last
+// bucket also takes every larger difference.
+struct ShapeStats {
+    static constexpr size_t kBalanceBuckets = 8;
+
+    size_t height = 0;
+    double average_depth = 0;
+    size_t balance[kBalanceBuckets] = {};
+};
+
+// Traits describe what the tree stores: how to get the key out of a value
+// and whether equal keys may repeat. All variants share one node engine.
+template <typename T>
+struct SetTraits {
+    using key_type = T;
+    using stats_type = NoStats;
+    using augment_type = NoAugment;
+    static constexpr bool unique = true;
+    static constexpr bool threaded = false;
+
+    static const key_type& key(const T& value) {
+        return value;
+    }
+};
+
+template <typename T>
+struct MultisetTraits : SetTraits<T> {
+    static constexpr bool unique = false;
+};
+
+template <typename Key, typename Value>
+struct MapTraits {
+    using key_type = Key;
+    using mapped_type = Value;
+    using stats_type = NoStats;
+    using augment_type = NoAugment;
+    static constexpr bool unique = true;
+    static constexpr bool threaded = false;
+
+    static const key_type& key(const std::pair<const Key, Value>& value) {
+        return value.first;
+    }
+};
+
+template <typename Key, typename Value>
+struct MultimapTraits : MapTraits<Key, Value> {
+    static constexpr bool unique = false;
+};
+
+// Threaded trees keep walk order neighbours in every node, so ++ and -- are
+// a single load. insert and erase keep the links in O(1), except a pre-order
+// right (post-order left) leaf which looks up its neighbour in O(h). Operations
+// that rebuild the shape (split, join, set operations) relink in O(n).
+template <typename Base>
+struct ThreadedTraits : Base {
+    static constexpr bool threaded = true;
+};
+
+// Counts comparator calls, visited nodes, allocations and relinks, see
+// BinaryTree::stats().
+template <typename Base>
+struct StatsTraits : Base {
+    using stats_type = CountingStats;
+};
+
+// Every node keeps Augment::combine of the summaries of its left subtree,
+// Augment::make(value) and its right subtree, in that order. Summaries are
+// recomputed on the path up from every node that gets new children.
+template <typename Base, typename Augment>
+struct AugmentedTraits : Base {
+    using augment_type = Augment;
+};
+
+// file dumps of trees, defined in tree_dump.h
+struct TreeDump;
+
+template <typename Compare>
+concept TransparentCompare = requires {
+    typename Compare::is_transparent;
+};
+
 template <typename T,
         WalkType WT = WalkType::InOrder,
         typename Compare = std::less<T>,
-        typename Alloc = std::allocator<T>>
+        typename Alloc = std::allocator<T>,
+        typename Traits = SetTraits<T>>
 class BinaryTree {
 public:
+    friend struct TreeDump;
+
     friend void swap(BinaryTree& left, BinaryTree& right) {
         left.swap(right);
     }
 
-    using key_type = const T;
+    class value_compare {
+    public:
+        bool operator()(const T& left, const T& right) const {
+            return compare(Traits::key(left), Traits::key(right));
+        }
+    private:
+        friend class BinaryTree;
+
+        value_compare(Compare compare): compare(compare) {}
+
+        Compare compare;
+    };
+
+    using key_type = const typename Traits::key_type;
     using value_type = const T;
     using size_type = size_t;
     using difference_type = int;
     using key_compare = Compare;
-    using value_compare = Compare;
     using allocator_type = Alloc;
     using reference = T&;
     using const_reference = const T&;
-    using iterator = BinaryTreeIterator<T, WT>;
-    using const_iterator = BinaryTreeIterator<T, WT>;
+    using iterator = std::conditional_t<Traits::threaded,
+            ThreadedBinaryTreeIterator<T>, BinaryTreeIterator<T, WT>>;
+    using const_iterator = iterator;
     using reverse_iterator = std::reverse_iterator<iterator>;
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
-    using node_type = Node<T>;
+    using augment_type = typename Traits::augment_type;
+    using node_type = std::conditional_t<std::is_same_v<augment_type, NoAugment>,
+            Node<T, std::conditional_t<Traits::threaded, ThreadedBaseNode, BaseNode>>,
+            AugmentedNode<T, std::conditional_t<Traits::threaded, ThreadedBaseNode, BaseNode>, augment_type>>;
     using insert_return_type = std::pair<iterator, bool>;
 
     explicit BinaryTree(const Compare& comp = Compare(),
@@ -53,7 +286,9 @@ public:
             compare_(comp),
             node_allocator_(),
             size_(0),
-            end_node_({&end_node_, &end_node_, &end_node_}) {}
+            end_node_({&end_node_, &end_node_, &end_node_}) {
+        rethread();
+    }
 
     explicit BinaryTree(const Alloc& alloc)
         : BinaryTree(Compare(), alloc) {}
@@ -69,6 +304,11 @@ public:
         copy(other);
     }
 
+    BinaryTree(BinaryTree&& other)
+            : BinaryTree(other.compare_) {
+        swap(other);
+    }
+
     template<typename InputIterator>
     BinaryTree(InputIterator first,
                InputIterator last,
@@ -96,7 +336,7 @@ public:
        : BinaryTree(init, Compare(), alloc) {}
 
     BinaryTree& operator=(BinaryTree other) {
-        swap(*this, other);
+        swap(other);
         return *this;
     }
 
@@ -150,53 +390,256 @@ public:
     }
 
     std::pair<iterator, bool> insert(const_reference value) {
-        if (size_ == 0) {
-            Node<T>* new_node = alloc_traits::allocate(node_allocator_, 1);
-            alloc_traits::construct(node_allocator_, new_node, value);
-            if constexpr(WT == WalkType::PreOrder) {
-                new_node->left = &end_node_;
+        auto position = descend(get_root(), Traits::key(value));
+        if (position.existing) {
+            return {iterator(position.existing), false};
+        }
+
+        return {place(make_node(value), position), true};
+    }
+
+    // Inserts as close as possible before hint. With a correct hint the node
+    // is attached next to it without a descent from the root.
+    iterator insert(const_iterator hint, const_reference value) {
+        auto position = hinted(const_cast<BaseNode*>(hint.current), Traits::key(value));
+        if (position.existing) {
+            return position.existing;
+        }
+
+        return place(make_node(value), position);
+    }
+
+    template <typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args) {
+        auto node = make_node(std::forward<Args>(args)...);
+        auto position = hinted(const_cast<BaseNode*>(hint.current), key_of(node));
+        if (position.existing) {
+            free_node(node);
+            return position.existing;
+        }
+
+        return place(node, position);
+    }
+
+    // Sorts the batch and inserts it in key order, each element is searched
+    // from the previous one instead of the root. Appending keys greater than
+    // the current maximum costs O(1) per element. Returns the number of
+    // inserted elements.
+    template <typename InputIterator>
+    size_t insert_batch(InputIterator first, InputIterator last) {
+        BaseNode head;
+        auto tail = &head;
+        size_t count = 0;
+        for (; first != last; ++first) {
+            tail->right = make_node(*first);
+            tail = tail->right;
+            ++count;
+        }
+        if (count == 0) {
+            return 0;
+        }
+        auto list = sort_nodes(head.right, count);
+        size_t inserted = 0;
+        BaseNode* finger = nullptr;
+        while (list) {
+            auto node = list;
+            list = list->right;
+            node->right = nullptr;
+            auto position = finger ? near(finger, key_of(node)) : descend(get_root(), key_of(node));
+            if (position.existing) {
+                free_node(node);
+                finger = position.existing;
+                continue;
+            }
+            finger = const_cast<BaseNode*>(place(node, position).current);
+            ++inserted;
+        }
+
+        return inserted;
+    }
+
+    template <typename Range>
+    size_t insert_batch(const Range& range) {
+        return insert_batch(std::begin(range), std::end(range));
+    }
+
+    const_iterator find(const key_type& key) const {
+        return find_node(key);
+    }
+
+    // heterogeneous lookup, the key is compared as is without conversion
+    template <typename K> requires TransparentCompare<Compare>
+    const_iterator find(const K& key) const {
+        return find_node(key);
+    }
+
+    const_iterator lower_bound(const key_type& key) const {
+        return lower_bound_node(key);
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    const_iterator lower_bound(const K& key) const {
+        return lower_bound_node(key);
+    }
+
+    const_iterator upper_bound(const key_type& key) const {
+        return upper_bound_node(key);
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    const_iterator upper_bound(const K& key) const {
+        return upper_bound_node(key);
+    }
+
+    std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+            requires (WT == WalkType::InOrder) {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    template <typename K> requires TransparentCompare<Compare> && (WT == WalkType::InOrder)
+    std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+        return {lower_bound(key), upper_bound(key)};
+    }
+
+    size_t count(const key_type& key) const {
+        return count_node(key);
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    size_t count(const K& key) const {
+        return count_node(key);
+    }
+
+    bool contains(const key_type& key) const {
+        return find_node(key) != &end_node_;
+    }
+
+    template <typename K> requires TransparentCompare<Compare>
+    bool contains(const K& key) const {
+        return find_node(key) != &end_node_;
+    }
+
+    size_t erase(const key_type& key) {
+        size_t erased = 0;
+        for (auto node = find_node(key); node != &end_node_; node = find_node(key)) {
+            erase(iterator(node));
+            ++erased;
+            if constexpr(Traits::unique) {
+                break;
             }
-            new_node->parent = &end_node_;
-            end_node_.parent = new_node;
-            end_node_.left = new_node;
-            end_node_.right = new_node;
-            ++size_;
-            return {iterator(new_node), true};
         }
 
-        return insert(value, get_root());
+        return erased;
     }
 
-    const_iterator find(const_reference value) const {
-        return find(value, get_root());
+    // summaries of augmented maps depend on the mapped values, so those
+    // are changed through insert_or_assign only
+    auto& at(const key_type& key) requires requires { typename Traits::mapped_type; } &&
+            std::is_same_v<augment_type, NoAugment> {
+        auto node = find_node(key);
+        if (node == &end_node_) {
+            throw std::out_of_range("BinaryTree::at: key not found");
+        }
+
+        return mutable_value(node).second;
     }
 
-    size_t erase(const_reference value) {
-        auto node = find(value, get_root());
+    const auto& at(const key_type& key) const requires requires { typename Traits::mapped_type; } {
+        auto node = find_node(key);
         if (node == &end_node_) {
-            return 0;
+            throw std::out_of_range("BinaryTree::at: key not found");
         }
-        erase(node);
 
-        return 1;
+        return value_of(node).second;
+    }
+
+    auto& operator[](const key_type& key) requires requires { typename Traits::mapped_type; } &&
+            Traits::unique && std::is_same_v<augment_type, NoAugment> {
+        auto node = find_node(key);
+        if (node == &end_node_) {
+            node = insert(T(key, typename Traits::mapped_type())).first.current;
+        }
+
+        return mutable_value(node).second;
+    }
+
+    template <typename V>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, V&& value)
+            requires requires { typename Traits::mapped_type; } && Traits::unique {
+        auto node = const_cast<BaseNode*>(find_node(key));
+        if (node == &end_node_) {
+            return insert(T(key, std::forward<V>(value)));
+        }
+        mutable_value(node).second = std::forward<V>(value);
+        refresh(node);
+
+        return {iterator(node), false};
     }
 
     iterator erase(iterator it) {
         auto node = const_cast<BaseNode*>(it.current);
         iterator response = it;
         ++response;
-        cut(node);
+        unthread(node);
+        refresh(cut(node));
         --size_;
         if (size_ != 0) {
             update_left();
             update_right();
-        }        
-        alloc_traits::destroy(node_allocator_, static_cast<Node<T>*>(node));
-        alloc_traits::deallocate(node_allocator_, static_cast<Node<T>*>(node), 1);
+        } else {
+            rethread();
+        }
+        free_node(node);
 
         return response;
     }
 
+    // Removes [first, last) and returns last. A key range of an in-order set
+    // is cut out with two splits and freed in one sweep, O(h + removed).
+    // Other trees unlink every node and rebuild the boundary links once.
+    iterator erase(const_iterator first, const_iterator last) {
+        if (first == last) {
+            return last;
+        }
+        if constexpr(WT == WalkType::InOrder && Traits::unique && !Traits::threaded) {
+            size_t total = size_;
+            auto [left, found, right] = split(release_root(), key_of(first.current));
+            size_t freed = 1;
+            free_node(found);
+            if (last != end()) {
+                auto rest = split(right, key_of(last.current));
+                freed += free_tree(rest.left);
+                right = join(nullptr, rest.found, rest.right);
+            } else {
+                freed += free_tree(right);
+                right = nullptr;
+            }
+            adopt_root(join(left, right), total - freed);
+        } else {
+            PieceList nodes;
+            for (; first != last; ++first) {
+                nodes.push({first.current, false});
+            }
+            erase_nodes(nodes);
+        }
+
+        return last;
+    }
+
+    // Removes every element satisfying pred in one walk and returns their number.
+    template <typename Pred>
+    size_t erase_if(Pred pred) {
+        PieceList nodes;
+        for (auto it = begin(); it != end(); ++it) {
+            if (pred(*it)) {
+                nodes.push({it.current, false});
+            }
+        }
+        erase_nodes(nodes);
+
+        return nodes.size;
+    }
+
     void merge(BinaryTree& other) {
         auto it = other.begin();
         while (it.current != other.end()) {
@@ -205,12 +648,184 @@ public:
         }
     }
 
+    // Elements not less than key move to the returned tree, nodes are relinked
+    // not copied. Takes O(h) plus counting the smaller of the two parts.
+    BinaryTree split(const key_type& key) {
+        BinaryTree response(compare_);
+        response.node_allocator_ = node_allocator_;
+        size_t total = size_;
+        auto [left, found, right] = split(release_root(), key);
+        if (found) {
+            right = join(nullptr, found, right);
+        }
+        size_t left_size = count_left_part(left, right, total);
+        adopt_root(left, left_size);
+        response.adopt_root(right, total - left_size);
+
+        return response;
+    }
+
+    // Every element of other must be greater than every element of this tree.
+    // Nodes of other are moved in O(h), other becomes empty.
+    void join(BinaryTree& other) {
+        size_t total = size_ + other.size_;
+        auto root = join(release_root(), other.release_root());
+        adopt_root(root, total);
+    }
+
+    // Set operations below move nodes out of other and leave it empty.
+    // They split other by the root of this tree and recurse into both
+    // halves, which is O(m log(n / m + 1)) on balanced input; halves of
+    // large inputs are processed by separate threads.
+    void unite(BinaryTree& other) requires Traits::unique {
+        size_t total = size_ + other.size_;
+        std::atomic<size_t> freed = 0;
+        int depth = fork_depth(total);
+        auto root = unite(release_root(), other.release_root(), freed, depth);
+        adopt_root(root, total - freed);
+    }
+
+    void intersect(BinaryTree& other) requires Traits::unique {
+        size_t total = size_ + other.size_;
+        std::atomic<size_t> freed = 0;
+        int depth = fork_depth(total);
+        auto root = intersect(release_root(), other.release_root(), freed, depth);
+        adopt_root(root, total - freed);
+    }
+
+    void subtract(BinaryTree& other) requires Traits::unique {
+        size_t total = size_ + other.size_;
+        std::atomic<size_t> freed = 0;
+        int depth = fork_depth(total);
+        auto root = subtract(release_root(), other.release_root(), freed, depth);
+        adopt_root(root, total - freed);
+    }
+
+    // Splits the walk into at most k consecutive non-empty subranges with
+    // equal numbers of elements and writes them to out as iterator pairs.
+    // Subtrees near the root are counted on worker threads, a degenerate
+    // tree (a chain) is counted sequentially.
+    template <typename OutputIt>
+    OutputIt partition(size_t k, OutputIt out) const {
+        return partition(frontier(whole_tree(), k * kOversplit), k, out);
+    }
+
+    // the same for [first, last) of an in-order tree
+    template <typename OutputIt>
+    OutputIt partition(const_iterator first, const_iterator last, size_t k, OutputIt out) const
+            requires (WT == WalkType::InOrder && Traits::unique) {
+        return partition(frontier(key_range(first, last), k * kOversplit), k, out);
+    }
+
+    // Calls func for every element on threads worker threads (all hardware
+    // threads by default). Subranges are handed out dynamically, so an uneven
+    // split only costs a little idle time at the end.
+    template <typename Func>
+    void parallel_for_each(Func func, size_t threads = 0) const {
+        parallel_for_each(whole_tree(), func, threads);
+    }
+
+    template <typename Func>
+    void parallel_for_each(const_iterator first, const_iterator last, Func func, size_t threads = 0) const
+            requires (WT == WalkType::InOrder && Traits::unique) {
+        parallel_for_each(key_range(first, last), func, threads);
+    }
+
+    // Folds every subrange with reduce starting from identity and folds the
+    // partial results with combine in walk order, so combine has to be
+    // associative but not commutative.
+    template <typename U, typename Reduce, typename Combine>
+    U parallel_reduce(U identity, Reduce reduce, Combine combine, size_t threads = 0) const {
+        return parallel_reduce(whole_tree(), identity, reduce, combine, threads);
+    }
+
+    template <typename U, typename Reduce, typename Combine>
+    U parallel_reduce(const_iterator first, const_iterator last,
+                      U identity, Reduce reduce, Combine combine, size_t threads = 0) const
+            requires (WT == WalkType::InOrder && Traits::unique) {
+        return parallel_reduce(key_range(first, last), identity, reduce, combine, threads);
+    }
+
+    // Folds the summaries of the elements with keys in [lo, hi) in key order,
+    // empty if there are none. Only the two boundary paths are walked, which
+    // is O(h).
+    auto reduce(const key_type& lo, const key_type& hi) const
+            requires (!std::is_same_v<augment_type, NoAugment>) {
+        std::optional<typename augment_type::summary_type> result;
+        const BaseNode* node = get_root();
+        while (!is_nil(node)) {
+            if (less(key_of(node), lo)) {
+                node = node->right;
+            } else if (!less(key_of(node), hi)) {
+                node = node->left;
+            } else {
+                break;
+            }
+        }
+        if (is_nil(node)) {
+            return result;
+        }
+        result = augment_type::make(value_of(node));
+        // keys not less than lo in the left subtree, prepended bottom up
+        for (auto cur = node->left; !is_nil(cur);) {
+            if (less(key_of(cur), lo)) {
+                cur = cur->right;
+                continue;
+            }
+            auto part = augment_type::make(value_of(cur));
+            if (!is_nil(cur->right)) {
+                part = augment_type::combine(part, summary_of(cur->right));
+            }
+            result = augment_type::combine(part, *result);
+            cur = cur->left;
+        }
+        // keys less than hi in the right subtree, appended
+        for (auto cur = node->right; !is_nil(cur);) {
+            if (!less(key_of(cur), hi)) {
+                cur = cur->left;
+                continue;
+            }
+            if (!is_nil(cur->left)) {
+                result = augment_type::combine(*result, summary_of(cur->left));
+            }
+            result = augment_type::combine(*result, augment_type::make(value_of(cur)));
+            cur = cur->right;
+        }
+
+        return result;
+    }
+
+    // Writes iterators to every interval sharing a point with [lo, hi] to out
+    // in key order. Subtrees whose largest end is less than lo and right
+    // subtrees of intervals starting after hi are skipped, so every reported
+    // interval costs O(h).
+    template <typename E, typename OutputIt>
+    OutputIt overlapping(const E& lo, const E& hi, OutputIt out) const
+            requires requires { typename augment_type::endpoint_type; } {
+        return overlapping(get_root(), lo, hi, out);
+    }
+
+    // Writes the elements in key order, see TreeDump::save. Needs
+    // tree_dump.h, which is kept out of this header for its POSIX includes.
+    template <typename Dump = TreeDump>
+    bool save(const std::string& path) const requires Dump::template dumpable<T> {
+        return Dump::save(*this, path);
+    }
+
+    // Replaces the contents with a file written by save, see TreeDump::load.
+    template <typename Dump = TreeDump>
+    bool load(const std::string& path) requires Dump::template dumpable<T> {
+        return Dump::load(*this, path);
+    }
+
     void swap(BinaryTree& other) {
         using std::swap;
         swap(size_, other.size_);
         swap(compare_, other.compare_);
         swap(node_allocator_, other.node_allocator_);
         swap(end_node_, other.end_node_);
+        relink_end_node();
+        other.relink_end_node();
     }
 
     size_type size() const {
@@ -230,16 +845,80 @@ public:
     }
 
     value_compare value_comp() const {
-        return value_comp();
-    };
+        return value_compare(compare_);
+    }
 
-    void clear() {
+    // zeros unless the traits are wrapped in StatsTraits
+    OperationStats stats() const {
+        return stats_.get();
+    }
+
+    void reset_stats() {
+        stats_.reset();
+    }
+
+    // Walks the whole tree once without recursion, so it is O(n) time and
+    // O(h) memory even for a chain.
+    ShapeStats shape_stats() const {
+        ShapeStats shape;
         if (size_ == 0) {
-            return;
+            return shape;
         }
-        recursive_free(get_root());
-        size_ = 0;
-        end_node_ = {&end_node_, &end_node_, &end_node_};
+        // heights of the finished subtrees of the current node at every depth
+        size_t capacity = 64;
+        auto left_height = std::make_unique<size_t[]>(capacity);
+        auto right_height = std::make_unique<size_t[]>(capacity);
+        size_t depth_sum = 0;
+        size_t depth = 0;
+        const BaseNode* prev = &end_node_;
+        const BaseNode* node = get_root();
+        while (node != &end_node_) {
+            const BaseNode* next = node->parent;
+            if (prev == node->parent) {
+                if (depth == capacity) {
+                    auto grown_left = std::make_unique<size_t[]>(2 * capacity);
+                    auto grown_right = std::make_unique<size_t[]>(2 * capacity);
+                    std::copy(left_height.get(), left_height.get() + capacity, grown_left.get());
+                    std::copy(right_height.get(), right_height.get() + capacity, grown_right.get());
+                    left_height = std::move(grown_left);
+                    right_height = std::move(grown_right);
+                    capacity *= 2;
+                }
+                left_height[depth] = 0;
+                right_height[depth] = 0;
+                depth_sum += depth;
+                if (!is_nil(node->left)) {
+                    next = node->left;
+                } else if (!is_nil(node->right)) {
+                    next = node->right;
+                }
+            } else if (prev == node->left && !is_nil(node->right)) {
+                next = node->right;
+            }
+            if (next != node->parent) {
+                ++depth;
+            } else {
+                size_t left = left_height[depth];
+                size_t right = right_height[depth];
+                size_t difference = left > right ? left - right : right - left;
+                ++shape.balance[std::min(difference, ShapeStats::kBalanceBuckets - 1)];
+                shape.height = std::max(shape.height, depth + 1);
+                if (depth > 0) {
+                    --depth;
+                    (node->parent->left == node ? left_height : right_height)[depth] = 1 + std::max(left, right);
+                }
+            }
+            prev = node;
+            node = next;
+        }
+        shape.average_depth = static_cast<double>(depth_sum) / size_;
+
+        return shape;
+    }
+
+    // O(n) without recursion, so deep trees are cleared too
+    void clear() {
+        free_tree(release_root());
     }
 
     ~BinaryTree() {
@@ -253,17 +932,25 @@ private:
     // [[no_unique_address]] node_allocator_type node_allocator_;
     node_allocator_type node_allocator_;
     Compare compare_;
-    BaseNode end_node_;
+    std::conditional_t<Traits::threaded, ThreadedBaseNode, BaseNode> end_node_;
     size_t size_;
+    [[no_unique_address]] mutable typename Traits::stats_type stats_;
+
+    template <typename A, typename B>
+    bool less(const A& left, const B& right) const {
+        stats_.compare();
+        return compare_(left, right);
+    }
 
     void update_left() {
         auto node = get_root();
-        if constexpr(WT == WalkType::PreOrder || WT == WalkType::InOrder) {
+        // pre-order begin is the root itself
+        if constexpr(WT == WalkType::InOrder) {
             while (node->left && node->left != &end_node_) {
                 node = node->left;
             }
             end_node_.right = node;
-        } else {
+        } else if constexpr(WT == WalkType::PostOrder) {
             while ((node->left && node->left != &end_node_) ||
               (node->right && node->right != &end_node_)) { 
                 if (node->left && node->left != &end_node_) {
@@ -294,6 +981,11 @@ private:
             }
             end_node_.parent = node;
             node->left = &end_node_;
+            node = get_root();
+            while (node->right && node->right != &end_node_) {
+                node = node->right;
+            }
+            end_node_.right = node;
         } else {
             while (node->right && node->right != &end_node_) {
                 node = node->right;
@@ -321,7 +1013,7 @@ private:
     BaseNode* get_next(BaseNode* node) {
         auto next = node->right;
         while (next->left && next->left != &end_node_) {
-            next = node->left;
+            next = next->left;
         }
 
         return next;
@@ -330,132 +1022,460 @@ private:
     const BaseNode* get_next(const BaseNode* node) const {
         auto next = node->right;
         while (next->left && next->left != &end_node_) {
-            next = node->left;
+            next = next->left;
         }
 
         return next;
     }
 
-    BaseNode* find(const_reference value, BaseNode* cur_node) {
-        if (!cur_node || cur_node == &end_node_) {
-            return &end_node_;
-        }
-        const auto& cur_value = static_cast<Node<T>*>(cur_node)->value;
-        if (compare_(value, cur_value)) {
-            return find(value, cur_node->left);
-        }
-        if (compare_(cur_value, value)) {
-            return find(value, cur_node->right);
-        }
+    static const key_type& key_of(const BaseNode* node) {
+        return Traits::key(static_cast<const node_type*>(node)->value);
+    }
 
-        return cur_node;
+    static const T& value_of(const BaseNode* node) {
+        return static_cast<const node_type*>(node)->value;
     }
 
-    const BaseNode* find(const_reference value, const BaseNode* cur_node) const {
-        if (!cur_node || cur_node == &end_node_) {
-            return &end_node_;
-        }
-        const auto& cur_value = static_cast<const Node<T>*>(cur_node)->value;
-        if (compare_(value, cur_value)) {
-            return find(value, cur_node->left);
-        }
-        if (compare_(cur_value, value)) {
-            return find(value, cur_node->right);
-        }
+    static T& mutable_value(const BaseNode* node) {
+        return static_cast<node_type*>(const_cast<BaseNode*>(node))->value;
+    }
 
-        return cur_node;
+    bool is_nil(const BaseNode* node) const {
+        return !node || node == &end_node_;
     }
 
-    const_iterator lower_bound(const_reference value) const {
-        const BaseNode* cur_node = get_root();
-        const_iterator response = cur_node;
-        while (cur_node != &end_node_) {
-            const_reference cur_value = static_cast<Node<T>>(cur_node)->value;
-            if (compare_(cur_value, value)) {
-                //cur_value < value
-                cur_node = cur_node->right;
-            } else {
-                // cur_value >= value
-                response = cur_node;
-                cur_node = cur_node->left;
+    static const auto& summary_of(const BaseNode* node) {
+        return static_cast<const node_type*>(node)->summary;
+    }
+
+    void recompute(BaseNode* node) {
+        if constexpr(!std::is_same_v<augment_type, NoAugment>) {
+            auto summary = augment_type::make(value_of(node));
+            if (!is_nil(node->left)) {
+                summary = augment_type::combine(summary_of(node->left), summary);
+            }
+            if (!is_nil(node->right)) {
+                summary = augment_type::combine(summary, summary_of(node->right));
             }
+            static_cast<node_type*>(node)->summary = std::move(summary);
         }
+    }
 
-        return response;
+    // recomputes node and its ancestors
+    void refresh(BaseNode* node) {
+        if constexpr(!std::is_same_v<augment_type, NoAugment>) {
+            for (; !is_nil(node); node = node->parent) {
+                recompute(node);
+            }
+        }
     }
 
-    const_iterator upper_bound(const_reference value) const {
-        const BaseNode* cur_node = get_root();
-        const_iterator response = cur_node;
-        while (cur_node != &end_node_) {
-            const_reference cur_value = static_cast<Node<T>>(cur_node)->value;
-            if (compare_(value, cur_value)) {
-                //value < cur_value
-                response = cur_node;
+    template <typename E, typename OutputIt>
+    OutputIt overlapping(const BaseNode* node, const E& lo, const E& hi, OutputIt out) const {
+        if (is_nil(node) || summary_of(node) < lo) {
+            return out;
+        }
+        out = overlapping(node->left, lo, hi, out);
+        const auto& interval = value_of(node);
+        if (hi < interval.first) {
+            return out;
+        }
+        if (!(interval.second < lo)) {
+            *out++ = const_iterator(node);
+        }
+
+        return overlapping(node->right, lo, hi, out);
+    }
+
+    // where a new key goes: under parent (nullptr for an empty tree) or
+    // nowhere if an equal key is present and keys are unique
+    struct InsertPosition {
+        BaseNode* parent;
+        bool to_left;
+        BaseNode* existing;
+    };
+
+    // the largest element, end_node_ keeps it for every walk type
+    BaseNode* rightmost() const {
+        if constexpr(WT == WalkType::PreOrder) {
+            return end_node_.right;
+        } else {
+            return end_node_.parent;
+        }
+    }
+
+    template <typename... Args>
+    node_type* make_node(Args&&... args) {
+        node_type* node = alloc_traits::allocate(node_allocator_, 1);
+        alloc_traits::construct(node_allocator_, node, std::forward<Args>(args)...);
+        stats_.allocate();
+
+        return node;
+    }
+
+    template <typename K>
+    InsertPosition descend(BaseNode* cur_node, const K& key) {
+        InsertPosition position{nullptr, false, nullptr};
+        while (!is_nil(cur_node)) {
+            stats_.visit();
+            position.parent = cur_node;
+            if (less(key, key_of(cur_node))) {
+                position.to_left = true;
                 cur_node = cur_node->left;
-            } else {
-                // value >= cur_value
+            } else if (!Traits::unique || less(key_of(cur_node), key)) {
+                position.to_left = false;
                 cur_node = cur_node->right;
+            } else {
+                position.existing = cur_node;
+                break;
             }
         }
 
-        return response;
+        return position;
     }
 
-    size_t count(const_reference value) const {
-        auto node = find(value);
+    // the in-order predecessor, end_node_ is treated as past the maximum
+    BaseNode* predecessor(BaseNode* node) const {
         if (node == &end_node_) {
-            return 0;
+            return size_ == 0 ? nullptr : rightmost();
+        }
+        if (!is_nil(node->left)) {
+            node = node->left;
+            while (!is_nil(node->right)) {
+                stats_.visit();
+                node = node->right;
+            }
+            return node;
+        }
+        while (node->parent != &end_node_ && node->parent->left == node) {
+            stats_.visit();
+            node = node->parent;
         }
 
-        return 1;
+        return node->parent == &end_node_ ? nullptr : node->parent;
     }
 
-    bool contains(const_reference value) const {
-        return count(value);
+    template <typename K>
+    InsertPosition hinted(BaseNode* hint, const K& key) {
+        if (size_ == 0) {
+            return {nullptr, false, nullptr};
+        }
+        bool before_hint = hint == &end_node_ || less(key, key_of(hint));
+        if (Traits::unique && !before_hint && !less(key_of(hint), key)) {
+            return {nullptr, false, hint};
+        }
+        if (!before_hint && (Traits::unique || less(key_of(hint), key))) {
+            return descend(get_root(), key);
+        }
+        // the minimum has nothing before it to check, so descending ingest
+        // at begin() does not climb the left spine
+        if constexpr(WT == WalkType::InOrder) {
+            if (hint == end_node_.right) {
+                return {hint, true, nullptr};
+            }
+        }
+        auto prev = predecessor(hint);
+        if (prev && less(key, key_of(prev))) {
+            return descend(get_root(), key);
+        }
+        if (prev && Traits::unique && !less(key_of(prev), key)) {
+            return {nullptr, false, prev};
+        }
+        if (hint != &end_node_ && is_nil(hint->left)) {
+            return {hint, true, nullptr};
+        }
+
+        return {prev, false, nullptr};
     }
 
-    std::pair<iterator, bool> insert(const_reference value, BaseNode* cur_node) {
-        const auto& cur_value = static_cast<Node<T>*>(cur_node)->value;
-        if (compare_(value, cur_value)) {
-            if (!cur_node->left || cur_node->left == &end_node_) {
-                Node<T>* new_node = alloc_traits::allocate(node_allocator_, 1);
-                alloc_traits::construct(node_allocator_, new_node, value);
-                cur_node->left = new_node;
-                new_node->parent = cur_node;
-                ++size_;
-                update_left();
-                update_right();
+    // Finger search for a key not less than the key of finger: climbs to the
+    // lowest ancestor whose subtree range covers the key and descends from it.
+    template <typename K>
+    InsertPosition near(BaseNode* finger, const K& key) {
+        if (finger == rightmost()) {
+            if (!Traits::unique || less(key_of(finger), key)) {
+                return {finger, false, nullptr};
+            }
+            return {nullptr, false, finger};
+        }
+        auto node = finger;
+        while (node->parent != &end_node_) {
+            if (node->parent->left == node && less(key, key_of(node->parent))) {
+                break;
+            }
+            node = node->parent;
+        }
 
-                return {iterator(new_node), true};
+        return descend(node, key);
+    }
+
+    iterator place(BaseNode* node, const InsertPosition& position) {
+        ++size_;
+        if (!position.parent) {
+            node->parent = &end_node_;
+            end_node_ = {node, node, node};
+            if constexpr(WT == WalkType::PreOrder) {
+                node->left = &end_node_;
             }
+            rethread();
+            refresh(node);
+            return node;
+        }
+        auto parent = position.parent;
+        node->parent = parent;
+        if (position.to_left) {
+            parent->left = node;
+        } else {
+            parent->right = node;
+        }
+        thread(node);
+        update_bounds(node);
+        refresh(node);
+
+        return node;
+    }
 
-            return insert(value, cur_node->left);
+    // Keeps end_node_ links valid after a leaf is attached, in O(1) unless
+    // the leaf may become the last pre-order (first post-order) node, which
+    // is checked by climbing while the path could lead to it.
+    void update_bounds(BaseNode* node) {
+        auto parent = node->parent;
+        bool is_left = parent->left == node;
+        if constexpr(WT == WalkType::InOrder) {
+            if (is_left && parent == end_node_.right) {
+                end_node_.right = node;
+            }
+            if (!is_left && parent == end_node_.parent) {
+                end_node_.parent = node;
+            }
+        } else if constexpr(WT == WalkType::PreOrder) {
+            if (!is_left && parent == end_node_.right) {
+                end_node_.right = node;
+            }
+            auto last = end_node_.parent;
+            bool is_last = parent == last;
+            for (auto cur = node; !is_last && cur->parent != &end_node_; cur = cur->parent) {
+                if (cur->parent->left == cur && !is_nil(cur->parent->right)) {
+                    return;
+                }
+            }
+            if (last->left == &end_node_) {
+                last->left = nullptr;
+            }
+            node->left = &end_node_;
+            end_node_.parent = node;
+        } else {
+            if (!is_left && parent == end_node_.parent) {
+                end_node_.parent = node;
+            }
+            bool is_first = parent == end_node_.left;
+            for (auto cur = node; !is_first && cur->parent != &end_node_; cur = cur->parent) {
+                if (cur->parent->right == cur && !is_nil(cur->parent->left)) {
+                    return;
+                }
+            }
+            end_node_.left = node;
+        }
+    }
+
+    static ThreadedBaseNode& threads(BaseNode* node) {
+        return *static_cast<ThreadedBaseNode*>(node);
+    }
+
+    void link_threads(BaseNode* prev, BaseNode* next) {
+        threads(prev).next = next;
+        threads(next).prev = prev;
+    }
+
+    // relinks the whole walk, the end node links to itself in an empty tree
+    void rethread() {
+        if constexpr(Traits::threaded) {
+            BaseNode* prev = &end_node_;
+            if (size_ != 0) {
+                BinaryTreeIterator<T, WT> it(WT == WalkType::InOrder ? end_node_.right : end_node_.left);
+                for (; it.current != &end_node_; ++it) {
+                    auto node = const_cast<BaseNode*>(it.current);
+                    link_threads(prev, node);
+                    prev = node;
+                }
+            }
+            link_threads(prev, &end_node_);
+        }
+    }
+
+    // links a new leaf already attached to its parent
+    void thread(BaseNode* node) {
+        if constexpr(Traits::threaded) {
+            auto parent = node->parent;
+            bool is_left = parent->left == node;
+            BaseNode* prev = parent;
+            if constexpr(WT == WalkType::InOrder) {
+                if (is_left) {
+                    prev = threads(parent).prev;
+                }
+            } else if constexpr(WT == WalkType::PreOrder) {
+                // a right child follows the last node of the left subtree
+                if (!is_left && !is_nil(parent->left)) {
+                    prev = parent->left;
+                    while (!is_nil(prev->left) || !is_nil(prev->right)) {
+                        prev = is_nil(prev->right) ? prev->left : prev->right;
+                    }
+                }
+            } else {
+                // a left child precedes the first node of the right subtree
+                BaseNode* next = parent;
+                if (is_left && !is_nil(parent->right)) {
+                    next = parent->right;
+                    while (!is_nil(next->left) || !is_nil(next->right)) {
+                        next = is_nil(next->left) ? next->right : next->left;
+                    }
+                }
+                prev = threads(next).prev;
+            }
+            auto next = threads(prev).next;
+            link_threads(prev, node);
+            link_threads(node, next);
+        }
+    }
+
+    // Unlinks a node that is about to be cut. A node with two children is
+    // replaced by its in-order successor, which takes its place in every
+    // walk while the rest of the walk keeps its order.
+    void unthread(BaseNode* node) {
+        if constexpr(Traits::threaded) {
+            if (is_nil(node->left) || is_nil(node->right)) {
+                link_threads(threads(node).prev, threads(node).next);
+                return;
+            }
+            auto replacement = get_next(node);
+            link_threads(threads(replacement).prev, threads(replacement).next);
+            link_threads(threads(node).prev, replacement);
+            link_threads(replacement, threads(node).next);
+        }
+    }
+
+    // stable merge sort of a list linked through right pointers
+    BaseNode* sort_nodes(BaseNode*& list, size_t count) {
+        if (count == 1) {
+            auto node = list;
+            list = list->right;
+            node->right = nullptr;
+            return node;
+        }
+        auto left = sort_nodes(list, count / 2);
+        auto right = sort_nodes(list, count - count / 2);
+        BaseNode head;
+        auto tail = &head;
+        while (left && right) {
+            if (less(key_of(right), key_of(left))) {
+                tail->right = right;
+                right = right->right;
+            } else {
+                tail->right = left;
+                left = left->right;
+            }
+            tail = tail->right;
         }
-        if (compare_(cur_value, value)) {
-            if (!cur_node->right || cur_node->right == &end_node_) {
-                Node<T>* new_node = alloc_traits::allocate(node_allocator_, 1);
-                alloc_traits::construct(node_allocator_, new_node, value);
-                cur_node->right = new_node;
-                new_node->parent = cur_node;
-                ++size_;
-                update_left();
-                update_right();
+        tail->right = left ? left : right;
+
+        return head.right;
+    }
 
-                return {iterator(new_node), true};
+    template <typename K>
+    const BaseNode* find_node(const K& key) const {
+        if constexpr(!Traits::unique) {
+            // the first of equal keys, so that find agrees with lower_bound
+            auto node = lower_bound_node(key);
+            if (node != &end_node_ && !less(key, key_of(node))) {
+                return node;
             }
+            return &end_node_;
+        }
+        const BaseNode* cur_node = get_root();
+        while (!is_nil(cur_node)) {
+            stats_.visit();
+            if (less(key, key_of(cur_node))) {
+                cur_node = cur_node->left;
+            } else if (less(key_of(cur_node), key)) {
+                cur_node = cur_node->right;
+            } else {
+                return cur_node;
+            }
+        }
 
-            return insert(value, cur_node->right);
+        return &end_node_;
+    }
+
+    template <typename K>
+    const BaseNode* lower_bound_node(const K& key) const {
+        const BaseNode* cur_node = get_root();
+        const BaseNode* response = &end_node_;
+        while (!is_nil(cur_node)) {
+            stats_.visit();
+            if (less(key_of(cur_node), key)) {
+                //cur_value < value
+                cur_node = cur_node->right;
+            } else {
+                // cur_value >= value
+                response = cur_node;
+                cur_node = cur_node->left;
+            }
         }
 
-        return {iterator(cur_node), false};
+        return response;
     }
 
-    void cut(BaseNode* node) {
+    template <typename K>
+    const BaseNode* upper_bound_node(const K& key) const {
+        const BaseNode* cur_node = get_root();
+        const BaseNode* response = &end_node_;
+        while (!is_nil(cur_node)) {
+            stats_.visit();
+            if (less(key, key_of(cur_node))) {
+                //value < cur_value
+                response = cur_node;
+                cur_node = cur_node->left;
+            } else {
+                // value >= cur_value
+                cur_node = cur_node->right;
+            }
+        }
+
+        return response;
+    }
+
+    template <typename K>
+    size_t count_node(const K& key) const {
+        if constexpr(Traits::unique) {
+            return find_node(key) != &end_node_;
+        } else {
+            return count_node(key, get_root());
+        }
+    }
+
+    template <typename K>
+    size_t count_node(const K& key, const BaseNode* cur_node) const {
+        if (is_nil(cur_node)) {
+            return 0;
+        }
+        stats_.visit();
+        if (less(key, key_of(cur_node))) {
+            return count_node(key, cur_node->left);
+        }
+        if (less(key_of(cur_node), key)) {
+            return count_node(key, cur_node->right);
+        }
+
+        return 1 + count_node(key, cur_node->left) + count_node(key, cur_node->right);
+    }
+
+    // returns the lowest node whose subtree lost a node, summaries are
+    // recomputed from it up
+    BaseNode* cut(BaseNode* node) {
         // cut node but not dealocate, and not update end_node_'s pointers
         if (size_ == 1) {
             end_node_ = {&end_node_, &end_node_, &end_node_};
-            return;
+            return &end_node_;
         }
         auto update_parent = [](BaseNode* old_sun, BaseNode* new_sun) {
             if (old_sun->parent->right == old_sun) {
@@ -466,27 +1486,29 @@ private:
             }
         };
         if ((!node->right || node->right == &end_node_) &&
-            (!node->left || node->right == &end_node_)) {
+            (!node->left || node->left == &end_node_)) {
             // node is leaf
             update_parent(node, nullptr);
-            return;
+            return node->parent;
         }
         if (!node->right || node->right == &end_node_) {
             // node has only left child
             update_parent(node, node->left);
             node->left->parent = node->parent;
-            return;
+            return node->parent;
         }
         if (!node->left || node->left == &end_node_) {
             // node has only right child
             update_parent(node, node->right);
             node->right->parent = node->parent;
-            return;
+            return node->parent;
         }
         auto next = get_next(node);
+        stats_.relink();
         node->left->parent = next;
         next->left = node->left;
         if (next->parent->left == next) {
+            auto lowest = next->parent;
             if (next->right && next->right != &end_node_) {
                 next->right->parent = next->parent;
             }
@@ -495,30 +1517,817 @@ private:
             next->right->parent = next;
             next->parent = node->parent;
             update_parent(node, next);
-            return;
+            return lowest;
         }
         update_parent(node, next);
         next->parent = node->parent;
+
+        return next;
+    }
+
+    static constexpr size_t kParallelThreshold = 1 << 16;
+
+    // nodes keep pointers to end_node_, so they must follow it on swap
+    void relink_end_node() {
+        if (size_ == 0) {
+            end_node_ = {&end_node_, &end_node_, &end_node_};
+            rethread();
+            return;
+        }
+        get_root()->parent = &end_node_;
+        if constexpr(WT == WalkType::PreOrder) {
+            end_node_.parent->left = &end_node_;
+        }
+        if constexpr(Traits::threaded) {
+            threads(end_node_.next).prev = &end_node_;
+            threads(end_node_.prev).next = &end_node_;
+        }
+    }
+
+    struct SplitResult {
+        BaseNode* left;
+        BaseNode* found;
+        BaseNode* right;
+    };
+
+    // Detaches the nodes from end_node_, leaving a plain tree with nullptr
+    // links and the tree itself empty.
+    BaseNode* release_root() {
+        if (size_ == 0) {
+            return nullptr;
+        }
+        if constexpr(WT == WalkType::PreOrder) {
+            end_node_.parent->left = nullptr;
+        }
+        auto root = get_root();
+        root->parent = nullptr;
+        end_node_ = {&end_node_, &end_node_, &end_node_};
+        size_ = 0;
+        rethread();
+
+        return root;
+    }
+
+    void adopt_root(BaseNode* root, size_t size) {
+        size_ = size;
+        end_node_ = {&end_node_, &end_node_, &end_node_};
+        if (root) {
+            root->parent = &end_node_;
+            end_node_ = {root, root, root};
+            update_left();
+            update_right();
+        }
+        rethread();
+    }
+
+    static void set_left(BaseNode* node, BaseNode* child) {
+        node->left = child;
+        if (child) {
+            child->parent = node;
+        }
+    }
+
+    static void set_right(BaseNode* node, BaseNode* child) {
+        node->right = child;
+        if (child) {
+            child->parent = node;
+        }
+    }
+
+    static BaseNode* detach(BaseNode* node) {
+        if (node) {
+            node->parent = nullptr;
+        }
+        return node;
+    }
+
+    // works on released trees: splits by key, the node equal to key is
+    // returned separately with its links cleared. Walks down once and hangs
+    // the nodes it passes on two hooks (the open right link of the left part
+    // and the open left link of the right part), so a chain needs no stack.
+    SplitResult split(BaseNode* node, const key_type& key) {
+        SplitResult result = {nullptr, nullptr, nullptr};
+        BaseNode* left_hook = nullptr;
+        BaseNode* right_hook = nullptr;
+        auto hang_left = [&](BaseNode* part) {
+            if (left_hook) {
+                set_right(left_hook, part);
+            } else {
+                result.left = detach(part);
+            }
+        };
+        auto hang_right = [&](BaseNode* part) {
+            if (right_hook) {
+                set_left(right_hook, part);
+            } else {
+                result.right = detach(part);
+            }
+        };
+        while (node) {
+            stats_.visit();
+            stats_.relink();
+            if (less(key, key_of(node)) || (!Traits::unique && !less(key_of(node), key))) {
+                auto next = detach(node->left);
+                node->left = nullptr;
+                hang_right(node);
+                right_hook = node;
+                node = next;
+            } else if (less(key_of(node), key)) {
+                auto next = detach(node->right);
+                node->right = nullptr;
+                hang_left(node);
+                left_hook = node;
+                node = next;
+            } else {
+                hang_left(detach(node->left));
+                hang_right(detach(node->right));
+                node->left = nullptr;
+                node->right = nullptr;
+                result.found = node;
+                break;
+            }
+        }
+        // the hooks are the deepest changed nodes of both parts
+        for (auto cur = left_hook; cur; cur = cur->parent) {
+            recompute(cur);
+        }
+        for (auto cur = right_hook; cur; cur = cur->parent) {
+            recompute(cur);
+        }
+
+        return result;
+    }
+
+    BaseNode* join(BaseNode* left, BaseNode* middle, BaseNode* right) {
+        set_left(middle, left);
+        set_right(middle, right);
+        middle->parent = nullptr;
+        recompute(middle);
+
+        return middle;
+    }
+
+    // every value of left is less than every value of right
+    BaseNode* join(BaseNode* left, BaseNode* right) {
+        if (!left) {
+            return right;
+        }
+        if (!right) {
+            return left;
+        }
+        auto max = left;
+        while (max->right) {
+            max = max->right;
+        }
+        stats_.relink();
+        if (max != left) {
+            set_right(max->parent, max->left);
+            refresh(max->parent);
+            max->left = nullptr;
+        } else {
+            left = detach(left->left);
+        }
+
+        return join(left, max, right);
+    }
+
+    // counts nodes of the smaller of two released trees by walking both
+    // at once, and derives the size of left from it
+    static size_t count_left_part(const BaseNode* left, const BaseNode* right, size_t total) {
+        auto first = [](const BaseNode* node) {
+            while (node && node->left) {
+                node = node->left;
+            }
+            return node;
+        };
+        auto next = [](const BaseNode* node) {
+            if (node->right) {
+                node = node->right;
+                while (node->left) {
+                    node = node->left;
+                }
+                return node;
+            }
+            while (node->parent && node->parent->right == node) {
+                node = node->parent;
+            }
+            return static_cast<const BaseNode*>(node->parent);
+        };
+        size_t counted = 0;
+        left = first(left);
+        right = first(right);
+        while (left && right) {
+            left = next(left);
+            right = next(right);
+            ++counted;
+        }
+        if (!left) {
+            return counted;
+        }
+
+        return total - counted;
+    }
+
+    int fork_depth(size_t total) const {
+        if (total < kParallelThreshold || !alloc_traits::is_always_equal::value) {
+            return 0;
+        }
+        int depth = 0;
+        for (unsigned threads = std::thread::hardware_concurrency(); threads > 1; threads /= 2) {
+            ++depth;
+        }
+
+        return depth;
+    }
+
+    // iterative, walk types other than in-order have no such iterator
+    template <typename Func>
+    void for_each_in_order(Func func) const {
+        if (size_ == 0) {
+            return;
+        }
+        const BaseNode* node = get_root();
+        while (!is_nil(node->left)) {
+            node = node->left;
+        }
+        while (node != &end_node_) {
+            func(node);
+            if (!is_nil(node->right)) {
+                node = node->right;
+                while (!is_nil(node->left)) {
+                    node = node->left;
+                }
+                continue;
+            }
+            while (node->parent != &end_node_ && node->parent->right == node) {
+                node = node->parent;
+            }
+            node = node->parent;
+        }
     }
 
-    void recursive_free(BaseNode* root) {
-        if (root->right && root->right != &end_node_){
-            recursive_free(root->right);
+    // whether next may follow prev in key order
+    bool in_order(const T& prev, const T& next) const {
+        const auto& prev_key = Traits::key(prev);
+        const auto& next_key = Traits::key(next);
+        if constexpr(Traits::unique) {
+            return less(prev_key, next_key);
+        } else {
+            return !less(next_key, prev_key);
         }
-//        root->right = nullptr;
-        if (root->left && root->left != &end_node_) {
-            recursive_free(root->left);
+    }
+
+    // read(i) gives the i-th element of a sorted sequence, the middle
+    // element of [first, last) becomes the root of the subtree
+    template <typename Read>
+    BaseNode* build_balanced(Read& read, size_t first, size_t last) {
+        if (first == last) {
+            return nullptr;
+        }
+        size_t middle = first + (last - first) / 2;
+        BaseNode* node = make_node(read(middle));
+        set_left(node, build_balanced(read, first, middle));
+        set_right(node, build_balanced(read, middle + 1, last));
+        recompute(node);
+
+        return node;
+    }
+
+    static constexpr size_t kOversplit = 8;
+
+    // a subtree or a single node, consecutive pieces follow the walk order
+    struct Piece {
+        const BaseNode* node;
+        bool whole;
+    };
+
+    struct PieceList {
+        std::unique_ptr<Piece[]> data;
+        size_t size = 0;
+        size_t capacity = 0;
+
+        void push(Piece piece) {
+            if (size == capacity) {
+                capacity = capacity == 0 ? 16 : 2 * capacity;
+                auto grown = std::make_unique<Piece[]>(capacity);
+                std::copy(data.get(), data.get() + size, grown.get());
+                data = std::move(grown);
+            }
+            data[size++] = piece;
         }
+    };
 
-        alloc_traits::destroy(node_allocator_, static_cast<Node<T>*>(root));
-        alloc_traits::deallocate(node_allocator_, static_cast<Node<T>*>(root), 1);
+    PieceList whole_tree() const {
+        PieceList pieces;
+        if (size_ != 0) {
+            pieces.push({get_root(), true});
+        }
+        return pieces;
+    }
+
+    // O(h) subtrees and nodes covering [first, last), in walk order. One
+    // loop finds the highest node in the range and one walks each boundary
+    // path below it, so a chain needs no stack.
+    PieceList key_range(const_iterator first, const_iterator last) const {
+        PieceList pieces;
+        if (first == last) {
+            return pieces;
+        }
+        const BaseNode* lo = first.current;
+        const BaseNode* hi = last.current;
+        auto below_hi = [&](const BaseNode* node) {
+            return hi == &end_node_ || less(key_of(node), key_of(hi));
+        };
+        const BaseNode* fork = get_root();
+        while (!is_nil(fork)) {
+            if (less(key_of(fork), key_of(lo))) {
+                fork = fork->right;
+            } else if (!below_hi(fork)) {
+                fork = fork->left;
+            } else {
+                break;
+            }
+        }
+        if (is_nil(fork)) {
+            return pieces;
+        }
+        // the lower boundary is walked top-down but its pieces come bottom-up
+        std::vector<Piece> lower;
+        for (auto node = fork->left; !is_nil(node);) {
+            if (less(key_of(node), key_of(lo))) {
+                node = node->right;
+                continue;
+            }
+            if (!is_nil(node->right)) {
+                lower.push_back({node->right, true});
+            }
+            lower.push_back({node, false});
+            node = node->left;
+        }
+        for (auto it = lower.rbegin(); it != lower.rend(); ++it) {
+            pieces.push(*it);
+        }
+        pieces.push({fork, false});
+        if (hi == &end_node_) {
+            if (!is_nil(fork->right)) {
+                pieces.push({fork->right, true});
+            }
+            return pieces;
+        }
+        for (auto node = fork->right; !is_nil(node);) {
+            if (!below_hi(node)) {
+                node = node->left;
+                continue;
+            }
+            if (!is_nil(node->left)) {
+                pieces.push({node->left, true});
+            }
+            pieces.push({node, false});
+            node = node->right;
+        }
+
+        return pieces;
+    }
+
+    // splits whole subtrees into their children until there are enough pieces
+    PieceList frontier(PieceList pieces, size_t target) const {
+        while (pieces.size < target) {
+            PieceList next;
+            for (size_t i = 0; i < pieces.size; ++i) {
+                auto piece = pieces.data[i];
+                auto left = piece.node->left;
+                auto right = piece.node->right;
+                if (!piece.whole || (is_nil(left) && is_nil(right))) {
+                    next.push({piece.node, false});
+                    continue;
+                }
+                if constexpr(WT == WalkType::PreOrder) {
+                    next.push({piece.node, false});
+                }
+                if (!is_nil(left)) {
+                    next.push({left, true});
+                }
+                if constexpr(WT == WalkType::InOrder) {
+                    next.push({piece.node, false});
+                }
+                if (!is_nil(right)) {
+                    next.push({right, true});
+                }
+                if constexpr(WT == WalkType::PostOrder) {
+                    next.push({piece.node, false});
+                }
+            }
+            if (next.size == pieces.size) {
+                break;
+            }
+            pieces = std::move(next);
+        }
+
+        return pieces;
+    }
+
+    std::pair<const_iterator, const_iterator> piece_range(Piece piece) const {
+        auto first = piece.node;
+        auto last = piece.node;
+        if (piece.whole) {
+            if constexpr(WT == WalkType::InOrder) {
+                while (!is_nil(first->left)) {
+                    first = first->left;
+                }
+                while (!is_nil(last->right)) {
+                    last = last->right;
+                }
+            } else if constexpr(WT == WalkType::PreOrder) {
+                while (!is_nil(last->left) || !is_nil(last->right)) {
+                    last = is_nil(last->right) ? last->left : last->right;
+                }
+            } else {
+                while (!is_nil(first->left) || !is_nil(first->right)) {
+                    first = is_nil(first->left) ? first->right : first->left;
+                }
+            }
+        }
+        const_iterator end(last);
+
+        return {const_iterator(first), ++end};
+    }
+
+    size_t worker_count(size_t threads, size_t total) const {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return total < kParallelThreshold / 16 ? 1 : threads;
+    }
+
+    // runs job(i) for every i < count, workers take indices one by one
+    template <typename Job>
+    static void run_workers(size_t threads, size_t count, Job job) {
+        std::atomic<size_t> next_index = 0;
+        auto work = [&] {
+            for (size_t i = next_index++; i < count; i = next_index++) {
+                job(i);
+            }
+        };
+        std::unique_ptr<std::thread[]> workers;
+        threads = std::min(threads, count);
+        if (threads > 1) {
+            workers = std::make_unique<std::thread[]>(threads - 1);
+            for (size_t i = 0; i + 1 < threads; ++i) {
+                workers[i] = std::thread(work);
+            }
+        }
+        work();
+        for (size_t i = 0; i + 1 < threads; ++i) {
+            workers[i].join();
+        }
+    }
+
+    template <typename OutputIt>
+    OutputIt partition(const PieceList& pieces, size_t k, OutputIt out) const {
+        if (pieces.size == 0 || k == 0) {
+            return out;
+        }
+        auto sizes = std::make_unique<size_t[]>(pieces.size);
+        run_workers(worker_count(0, size_), pieces.size, [&](size_t i) {
+            auto [first, last] = piece_range(pieces.data[i]);
+            sizes[i] = 0;
+            for (; first != last; ++first) {
+                ++sizes[i];
+            }
+        });
+        size_t total = 0;
+        for (size_t i = 0; i < pieces.size; ++i) {
+            total += sizes[i];
+        }
+        k = std::min(k, total);
+        // the part with index part ends after (part + 1) * total / k elements
+        auto begin = piece_range(pieces.data[0]).first;
+        size_t part = 0;
+        size_t passed = 0;
+        for (size_t i = 0; i < pieces.size; ++i) {
+            auto [first, last] = piece_range(pieces.data[i]);
+            size_t offset = 0;
+            while (part + 1 < k && passed + sizes[i] - offset >= (part + 1) * total / k) {
+                size_t step = (part + 1) * total / k - passed;
+                for (size_t j = 0; j < step; ++j) {
+                    ++first;
+                }
+                offset += step;
+                passed += step;
+                *out++ = std::make_pair(begin, first);
+                begin = first;
+                ++part;
+            }
+            passed += sizes[i] - offset;
+            if (i + 1 == pieces.size) {
+                *out++ = std::make_pair(begin, last);
+            }
+        }
+
+        return out;
+    }
+
+    template <typename Func>
+    void parallel_for_each(PieceList range, Func& func, size_t threads) const {
+        threads = worker_count(threads, size_);
+        auto pieces = frontier(std::move(range), threads * kOversplit);
+        run_workers(threads, pieces.size, [&](size_t i) {
+            auto [first, last] = piece_range(pieces.data[i]);
+            for (; first != last; ++first) {
+                func(*first);
+            }
+        });
+    }
+
+    template <typename U, typename Reduce, typename Combine>
+    U parallel_reduce(PieceList range, const U& identity,
+                      Reduce& reduce, Combine& combine, size_t threads) const {
+        threads = worker_count(threads, size_);
+        auto pieces = frontier(std::move(range), threads * kOversplit);
+        auto partial = std::make_unique<std::optional<U>[]>(pieces.size);
+        run_workers(threads, pieces.size, [&](size_t i) {
+            auto [first, last] = piece_range(pieces.data[i]);
+            U result = identity;
+            for (; first != last; ++first) {
+                result = reduce(std::move(result), *first);
+            }
+            partial[i] = std::move(result);
+        });
+        U result = identity;
+        for (size_t i = 0; i < pieces.size; ++i) {
+            result = combine(std::move(result), std::move(*partial[i]));
+        }
+
+        return result;
+    }
+
+    void free_node(BaseNode* node) {
+        stats_.deallocate();
+        alloc_traits::destroy(node_allocator_, static_cast<node_type*>(node));
+        alloc_traits::deallocate(node_allocator_, static_cast<node_type*>(node), 1);
+    }
+
+    // Post-order sweep over a released tree: a leaf is freed and unlinked
+    // from its parent, so the walk climbs back through parent links without
+    // a stack. Returns the number of freed nodes.
+    size_t free_tree(BaseNode* node) {
+        size_t freed = 0;
+        while (node) {
+            if (node->left) {
+                node = node->left;
+                continue;
+            }
+            if (node->right) {
+                node = node->right;
+                continue;
+            }
+            auto parent = node->parent;
+            if (parent) {
+                (parent->left == node ? parent->left : parent->right) = nullptr;
+            }
+            free_node(node);
+            ++freed;
+            node = parent;
+        }
+
+        return freed;
+    }
+
+    void free_tree(BaseNode* root, std::atomic<size_t>& freed) {
+        freed += free_tree(root);
+    }
+
+    // Unlinks and frees the given nodes, boundary links are rebuilt once
+    // at the end instead of after every node. From one in kRebuildShare of
+    // an in-order tree on, the survivors are relinked balanced in one O(n)
+    // pass instead of cutting every node and refreshing its path. The shape
+    // of pre- and post-order trees is their walk order, so they always cut.
+    static constexpr size_t kRebuildShare = 8;
+
+    void erase_nodes(const PieceList& nodes) {
+        if (WT == WalkType::InOrder && nodes.size != 0 && nodes.size * kRebuildShare >= size_) {
+            std::vector<const BaseNode*> doomed(nodes.size);
+            for (size_t i = 0; i < nodes.size; ++i) {
+                doomed[i] = nodes.data[i].node;
+            }
+            std::sort(doomed.begin(), doomed.end(), std::less<>());
+            size_t total = size_;
+            std::vector<BaseNode*> kept;
+            kept.reserve(total);
+            flatten(release_root(), kept);
+            auto last = std::remove_if(kept.begin(), kept.end(), [&](BaseNode* node) {
+                if (!std::binary_search(doomed.begin(), doomed.end(), node, std::less<>())) {
+                    return false;
+                }
+                free_node(node);
+                return true;
+            });
+            kept.erase(last, kept.end());
+            adopt_root(detach(link_balanced(kept, 0, kept.size())), total - nodes.size);
+            return;
+        }
+        if constexpr(WT == WalkType::PreOrder) {
+            // the last pre-order node may be among them, drop its link to end_node_
+            if (size_ != 0 && end_node_.parent->left == &end_node_) {
+                end_node_.parent->left = nullptr;
+            }
+            end_node_.parent = &end_node_;
+        }
+        for (size_t i = 0; i < nodes.size; ++i) {
+            auto node = const_cast<BaseNode*>(nodes.data[i].node);
+            unthread(node);
+            refresh(cut(node));
+            --size_;
+            free_node(node);
+        }
+        if (size_ != 0) {
+            update_left();
+            update_right();
+        } else {
+            rethread();
+        }
+    }
+
+    // The set operations recurse once per level of the first tree, depth
+    // counts down from the fork depth. A subtree deeper than kMaxSetDepth
+    // (the tree is not balanced, sorted inserts make a chain) is merged flat
+    // instead, in time linear in both parts and without the stack.
+    static constexpr int kMaxSetDepth = 96;
+
+    enum class SetOperation {
+        Unite,
+        Intersect,
+        Subtract,
+    };
+
+    // in-order nodes of a released tree
+    static void flatten(BaseNode* node, std::vector<BaseNode*>& out) {
+        std::vector<BaseNode*> path;
+        while (node || !path.empty()) {
+            while (node) {
+                path.push_back(node);
+                node = node->left;
+            }
+            node = path.back();
+            path.pop_back();
+            out.push_back(node);
+            node = node->right;
+        }
+    }
+
+    // the middle node of [first, last) becomes the root of the subtree
+    BaseNode* link_balanced(const std::vector<BaseNode*>& nodes, size_t first, size_t last) {
+        if (first == last) {
+            return nullptr;
+        }
+        size_t middle = first + (last - first) / 2;
+        BaseNode* node = nodes[middle];
+        set_left(node, link_balanced(nodes, first, middle));
+        set_right(node, link_balanced(nodes, middle + 1, last));
+        recompute(node);
+
+        return node;
+    }
+
+    // keeps the nodes of first on equal keys, like the recursive versions
+    BaseNode* combine_flat(BaseNode* first, BaseNode* second, std::atomic<size_t>& freed, SetOperation operation) {
+        std::vector<BaseNode*> first_nodes;
+        std::vector<BaseNode*> second_nodes;
+        flatten(first, first_nodes);
+        flatten(second, second_nodes);
+        std::vector<BaseNode*> kept;
+        kept.reserve(first_nodes.size() + (operation == SetOperation::Unite ? second_nodes.size() : 0));
+        auto drop = [this, &freed](BaseNode* node) {
+            free_node(node);
+            ++freed;
+        };
+        size_t i = 0;
+        size_t j = 0;
+        while (i < first_nodes.size() || j < second_nodes.size()) {
+            if (j == second_nodes.size() || (i < first_nodes.size() &&
+                                             less(key_of(first_nodes[i]), key_of(second_nodes[j])))) {
+                if (operation == SetOperation::Intersect) {
+                    drop(first_nodes[i]);
+                } else {
+                    kept.push_back(first_nodes[i]);
+                }
+                ++i;
+            } else if (i == first_nodes.size() || less(key_of(second_nodes[j]), key_of(first_nodes[i]))) {
+                if (operation == SetOperation::Unite) {
+                    kept.push_back(second_nodes[j]);
+                } else {
+                    drop(second_nodes[j]);
+                }
+                ++j;
+            } else {
+                if (operation == SetOperation::Subtract) {
+                    drop(first_nodes[i]);
+                } else {
+                    kept.push_back(first_nodes[i]);
+                }
+                drop(second_nodes[j]);
+                ++i;
+                ++j;
+            }
+        }
+
+        return detach(link_balanced(kept, 0, kept.size()));
+    }
+
+    // runs both halves of a set operation, the left one on a new thread
+    // while depth allows
+    template <typename Func>
+    std::pair<BaseNode*, BaseNode*> fork(Func func, int depth) {
+        if (depth <= 0) {
+            auto left = func(true);
+            return {left, func(false)};
+        }
+        auto left = std::async(std::launch::async, func, true);
+        auto right = func(false);
+
+        return {left.get(), right};
+    }
+
+    BaseNode* unite(BaseNode* first, BaseNode* second, std::atomic<size_t>& freed, int depth) {
+        if (!first) {
+            return second;
+        }
+        if (!second) {
+            return first;
+        }
+        if (depth < -kMaxSetDepth) {
+            return combine_flat(first, second, freed, SetOperation::Unite);
+        }
+        auto first_left = detach(first->left);
+        auto first_right = detach(first->right);
+        auto parts = split(second, key_of(first));
+        if (parts.found) {
+            free_node(parts.found);
+            ++freed;
+        }
+        auto [left, right] = fork([&](bool is_left) {
+            return is_left ? unite(first_left, parts.left, freed, depth - 1)
+                           : unite(first_right, parts.right, freed, depth - 1);
+        }, depth);
+
+        return join(left, first, right);
+    }
+
+    BaseNode* intersect(BaseNode* first, BaseNode* second, std::atomic<size_t>& freed, int depth) {
+        if (!first || !second) {
+            free_tree(first, freed);
+            free_tree(second, freed);
+            return nullptr;
+        }
+        if (depth < -kMaxSetDepth) {
+            return combine_flat(first, second, freed, SetOperation::Intersect);
+        }
+        auto first_left = detach(first->left);
+        auto first_right = detach(first->right);
+        auto parts = split(second, key_of(first));
+        auto [left, right] = fork([&](bool is_left) {
+            return is_left ? intersect(first_left, parts.left, freed, depth - 1)
+                           : intersect(first_right, parts.right, freed, depth - 1);
+        }, depth);
+        if (parts.found) {
+            free_node(parts.found);
+            ++freed;
+            return join(left, first, right);
+        }
+        free_node(first);
+        ++freed;
+
+        return join(left, right);
+    }
+
+    BaseNode* subtract(BaseNode* first, BaseNode* second, std::atomic<size_t>& freed, int depth) {
+        if (!first || !second) {
+            free_tree(second, freed);
+            return first;
+        }
+        if (depth < -kMaxSetDepth) {
+            return combine_flat(first, second, freed, SetOperation::Subtract);
+        }
+        auto first_left = detach(first->left);
+        auto first_right = detach(first->right);
+        auto parts = split(second, key_of(first));
+        auto [left, right] = fork([&](bool is_left) {
+            return is_left ? subtract(first_left, parts.left, freed, depth - 1)
+                           : subtract(first_right, parts.right, freed, depth - 1);
+        }, depth);
+        if (parts.found) {
+            free_node(parts.found);
+            free_node(first);
+            freed += 2;
+            return join(left, right);
+        }
+
+        return join(left, first, right);
     }
 
     void recursive_copy(BaseNode* this_cur, const BaseNode* other_cur, const BaseNode* other_end) {
         if (other_cur->left && other_cur->left != other_end) {
-            Node<T>* new_node = alloc_traits::allocate(node_allocator_, 1);
-            alloc_traits::construct(node_allocator_, new_node,
-                                    static_cast<Node<T>*>(other_cur->left)->value);
+            node_type* new_node = make_node(static_cast<const node_type*>(other_cur->left)->value);
             this_cur->left = new_node;
             new_node->parent = this_cur;
             recursive_copy(new_node, other_cur->left, other_end);
@@ -526,48 +2335,97 @@ private:
             this_cur->left = nullptr;
         }
         if (other_cur->right && other_cur->right != other_end) {
-            Node<T>* new_node = alloc_traits::allocate(node_allocator_, 1);
-            alloc_traits::construct(node_allocator_, new_node,
-                                    static_cast<Node<T>*>(other_cur->right)->value);
+            node_type* new_node = make_node(static_cast<const node_type*>(other_cur->right)->value);
             this_cur->right = new_node;
             new_node->parent = this_cur;
             recursive_copy(new_node, other_cur->right, other_end);
         } else {
             this_cur->right = nullptr;
         }
+        recompute(this_cur);
     }
 
     void copy(const BinaryTree& other) {
         size_ = other.size_;
         end_node_ = {&end_node_, &end_node_, &end_node_};
         if (size_ == 0) {
+            rethread();
             return;
         }
         if constexpr(WT == WalkType::PreOrder || WT == WalkType::InOrder ) {
-            Node<T>* root = alloc_traits::allocate(node_allocator_, 1);
-            alloc_traits::construct(node_allocator_, root,
-                                    static_cast<const Node<T>*>(other.end_node_.left)->value);
+            node_type* root = make_node(static_cast<const node_type*>(other.end_node_.left)->value);
             root->parent = &end_node_;
             end_node_.left = root;
             recursive_copy(root, other.end_node_.left, &other.end_node_);
         } else {
-            Node<T>* root = alloc_traits::allocate(node_allocator_, 1);
-            alloc_traits::construct(node_allocator_, root,
-                                    static_cast<const Node<T>*>(other.end_node_.right)->value);
+            node_type* root = make_node(static_cast<const node_type*>(other.end_node_.right)->value);
             root->parent = &end_node_;
             end_node_.right = root;
             recursive_copy(root, other.end_node_.right, &other.end_node_);
         }
         update_left();
         update_right();
+        rethread();
     }
 };
 
-template <typename T>
-struct Node : BaseNode {
-    typename BinaryTree<T>::value_type value;
-    
-    Node(const T& value): BaseNode(), value(value){}
+template <typename T,
+        WalkType WT = WalkType::InOrder,
+        typename Compare = std::less<T>,
+        typename Alloc = std::allocator<T>>
+using ThreadedBinaryTree = BinaryTree<T, WT, Compare, Alloc, ThreadedTraits<SetTraits<T>>>;
+
+template <typename T,
+        WalkType WT = WalkType::InOrder,
+        typename Compare = std::less<T>,
+        typename Alloc = std::allocator<T>>
+using BinaryMultiset = BinaryTree<T, WT, Compare, Alloc, MultisetTraits<T>>;
+
+template <typename Key,
+        typename Value,
+        WalkType WT = WalkType::InOrder,
+        typename Compare = std::less<Key>,
+        typename Alloc = std::allocator<std::pair<const Key, Value>>>
+using BinaryMap = BinaryTree<std::pair<const Key, Value>, WT, Compare, Alloc, MapTraits<Key, Value>>;
+
+template <typename Key,
+        typename Value,
+        WalkType WT = WalkType::InOrder,
+        typename Compare = std::less<Key>,
+        typename Alloc = std::allocator<std::pair<const Key, Value>>>
+using BinaryMultimap = BinaryTree<std::pair<const Key, Value>, WT, Compare, Alloc, MultimapTraits<Key, Value>>;
+
+template <typename Endpoint,
+        WalkType WT = WalkType::InOrder,
+        typename Alloc = std::allocator<std::pair<Endpoint, Endpoint>>>
+using IntervalBinaryTree = BinaryTree<std::pair<Endpoint, Endpoint>, WT, std::less<std::pair<Endpoint, Endpoint>>, Alloc,
+        AugmentedTraits<MultisetTraits<std::pair<Endpoint, Endpoint>>, IntervalAugment<Endpoint>>>;
+
+template <typename Key,
+        typename Value,
+        typename Combine = std::plus<Value>,
+        WalkType WT = WalkType::InOrder,
+        typename Compare = std::less<Key>,
+        typename Alloc = std::allocator<std::pair<const Key, Value>>>
+using AggregateBinaryMap = BinaryTree<std::pair<const Key, Value>, WT, Compare, Alloc,
+        AugmentedTraits<MapTraits<Key, Value>, MonoidAugment<Value, Combine>>>;
+
+template <typename T, typename Base>
+struct Node : Base {
+    T value;
+
+    Node(const T& value): Base(), value(value){}
+
+    template <typename... Args>
+    Node(Args&&... args): Base(), value(std::forward<Args>(args)...) {}
+};
+
+template <typename T, typename Base, typename Augment>
+struct AugmentedNode : Node<T, Base> {
+    typename Augment::summary_type summary;
+
+    template <typename... Args>
+    AugmentedNode(Args&&... args): Node<T, Base>(std::forward<Args>(args)...), summary() {}
 };
 
 template <typename T>
@@ -579,6 +2437,10 @@ public:
         return static_cast<const Node<T>*>(current)->value;
     }
 
+    const T* operator->() const {
+        return &static_cast<const Node<T>*>(current)->value;
+    }
+
     friend bool operator==(const BaseBinaryTreeIterator& lhs, const BaseBinaryTreeIterator& rhs) {
         return lhs.current == rhs.current;
     }
@@ -593,7 +2455,8 @@ protected:
 template <typename T>
 class BinaryTreeIterator<T, WalkType::PreOrder>: public BaseBinaryTreeIterator<T> {
 public:
-    friend class BinaryTree<T, WalkType::PreOrder>;
+    template <typename, WalkType, typename, typename, typename>
+    friend class BinaryTree;
 
     BinaryTreeIterator& operator++() {
         if (current->left) {
@@ -604,14 +2467,10 @@ public:
             current = current->right;
             return *this;
         }
-        while (current->parent->right == current) {
-            current = current->parent;
-        }
-        current = current->parent;
-        while (current->right == nullptr) {
+        while (current->parent->left != current || !current->parent->right) {
             current = current->parent;
         }
-        current = current->right;
+        current = current->parent->right;
 
         return *this;
     }
@@ -650,7 +2509,8 @@ private:
 template <typename T>
 class BinaryTreeIterator<T, WalkType::InOrder>: public BaseBinaryTreeIterator<T> {
 public:
-    friend class BinaryTree<T, WalkType::InOrder>;
+    template <typename, WalkType, typename, typename, typename>
+    friend class BinaryTree;
 
     BinaryTreeIterator& operator++() {
         if (current->right) {
@@ -701,10 +2561,11 @@ private:
 template <typename T>
 class BinaryTreeIterator<T, WalkType::PostOrder>: public BaseBinaryTreeIterator<T> {
 public:
-    friend class BinaryTree<T, WalkType::PostOrder>;
+    template <typename, WalkType, typename, typename, typename>
+    friend class BinaryTree;
 
     BinaryTreeIterator& operator++() {
-        if (current->parent->right == current) {
+        if (current->parent->right == current || !current->parent->right) {
             current = current->parent;
             return *this;
         }
@@ -745,4 +2606,53 @@ private:
     using BaseBinaryTreeIterator<T>::current;
 
     BinaryTreeIterator(const BaseNode* node): BaseBinaryTreeIterator<T>(node) {}
-};
\ No newline at end of file
+};
+
+template <typename T>
+class ThreadedBinaryTreeIterator {
+public:
+    template <typename, WalkType, typename, typename, typename>
+    friend class BinaryTree;
+
+    const T& operator*() const {
+        return static_cast<const Node<T, ThreadedBaseNode>*>(current)->value;
+    }
+
+    const T* operator->() const {
+        return &static_cast<const Node<T, ThreadedBaseNode>*>(current)->value;
+    }
+
+    ThreadedBinaryTreeIterator& operator++() {
+        current = static_cast<const ThreadedBaseNode*>(current)->next;
+        return *this;
+    }
+
+    ThreadedBinaryTreeIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    ThreadedBinaryTreeIterator& operator--() {
+        current = static_cast<const ThreadedBaseNode*>(current)->prev;
+        return *this;
+    }
+
+    ThreadedBinaryTreeIterator operator--(int) {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    friend bool operator==(const ThreadedBinaryTreeIterator& lhs, const ThreadedBinaryTreeIterator& rhs) {
+        return lhs.current == rhs.current;
+    }
+
+    friend bool operator!=(const ThreadedBinaryTreeIterator& lhs, const ThreadedBinaryTreeIterator& rhs) {
+        return lhs.current != rhs.current;
+    }
+private:
+    const BaseNode* current;
+
+    ThreadedBinaryTreeIterator(const BaseNode* node): current(node) {}
+};
@@ -0,0 +1,147 @@
+#pragma once
+#include "tree.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Byte layout of an element in files written by BinaryTree::save. Values are
+// copied as raw bytes, so only trivially copyable types (and pairs of them,
+// as stored by maps) can be saved.
+template <typename T>
+struct DumpFormat {
+    static constexpr bool enabled = std::is_trivially_copyable_v<T>;
+    static constexpr size_t size = sizeof(T);
+
+    static void write(unsigned char* out, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+    }
+
+    static T read(const unsigned char* in) {
+        struct Bytes {
+            unsigned char data[sizeof(T)];
+        } bytes;
+        std::memcpy(bytes.data, in, sizeof(T));
+        return std::bit_cast<T>(bytes);
+    }
+};
+
+template <typename Key, typename Value>
+struct DumpFormat<std::pair<const Key, Value>> {
+    static constexpr bool enabled = DumpFormat<Key>::enabled && DumpFormat<Value>::enabled;
+    static constexpr size_t size = sizeof(Key) + sizeof(Value);
+
+    static void write(unsigned char* out, const std::pair<const Key, Value>& value) {
+        DumpFormat<Key>::write(out, value.first);
+        DumpFormat<Value>::write(out + sizeof(Key), value.second);
+    }
+
+    static std::pair<const Key, Value> read(const unsigned char* in) {
+        return {DumpFormat<Key>::read(in), DumpFormat<Value>::read(in + sizeof(Key))};
+    }
+};
+
+// Saving and loading of BinaryTree, reached through tree.save(path) and
+// tree.load(path) once this header is included. It is kept out of tree.h
+// since it needs the POSIX headers for mmap.
+struct TreeDump {
+    template <typename T>
+    static constexpr bool dumpable = DumpFormat<T>::enabled;
+
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t value_size;
+        uint64_t count;
+        uint64_t reserved;
+    };
+
+    // Writes the elements in key order: a 32 byte header (magic, version,
+    // element size, count) and the raw bytes of every element. Returns false
+    // if the file can not be written.
+    template <typename Tree>
+    static bool save(const Tree& tree, const std::string& path) {
+        using Format = DumpFormat<std::remove_const_t<typename Tree::value_type>>;
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        Header header{{'B', 'I', 'N', 'T', 'R', 'E', 'E', '\0'}, kVersion,
+                      static_cast<uint32_t>(Format::size), tree.size_, 0};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        // elements are gathered in blocks of at least 64 KiB
+        std::vector<unsigned char> buffer(std::max<size_t>(1 << 16, Format::size));
+        size_t used = 0;
+        tree.for_each_in_order([&](const auto* node) {
+            if (used + Format::size > buffer.size()) {
+                file.write(reinterpret_cast<const char*>(buffer.data()), used);
+                used = 0;
+            }
+            Format::write(buffer.data() + used, Tree::value_of(node));
+            used += Format::size;
+        });
+        file.write(reinterpret_cast<const char*>(buffer.data()), used);
+
+        return static_cast<bool>(file.flush());
+    }
+
+    // Replaces the contents with a file written by save. The file is mapped
+    // and the tree is built balanced straight from the sorted array in O(n)
+    // without comparisons beyond one order check. Returns false and leaves
+    // the tree empty if the file is missing, of another type or not sorted.
+    template <typename Tree>
+    static bool load(Tree& tree, const std::string& path) {
+        using Format = DumpFormat<std::remove_const_t<typename Tree::value_type>>;
+        tree.clear();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        size_t length = info.st_size;
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        auto data = static_cast<const unsigned char*>(mapped);
+        Header header;
+        std::memcpy(&header, data, sizeof(header));
+        // count * size may wrap for a corrupt count, so the length is divided
+        size_t body = length - sizeof(header);
+        bool valid = std::memcmp(header.magic, "BINTREE", 8) == 0 &&
+                     header.version == kVersion &&
+                     header.value_size == Format::size &&
+                     body % Format::size == 0 && body / Format::size == header.count;
+        data += sizeof(header);
+        auto read = [data](size_t i) {
+            return Format::read(data + i * Format::size);
+        };
+        for (size_t i = 1; valid && i < header.count; ++i) {
+            valid = tree.in_order(read(i - 1), read(i));
+        }
+        if (valid) {
+            tree.adopt_root(tree.build_balanced(read, 0, header.count), header.count);
+        }
+        ::munmap(mapped, length);
+
+        return valid;
+    }
+};
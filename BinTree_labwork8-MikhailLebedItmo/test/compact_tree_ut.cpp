@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "../lib/compact_tree.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+template <typename Tree>
+std::vector<int> walk(const Tree& tree) {
+    std::vector<int> result;
+    for (auto x: tree) {
+        result.push_back(x);
+    }
+    return result;
+}
+
+template <typename Tree>
+std::vector<int> walk_backward(const Tree& tree) {
+    std::vector<int> result;
+    for (auto it = tree.end(); it != tree.begin();) {
+        result.push_back(*--it);
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+// both trees get the same operations, so they have the same shape
+template <WalkType WT>
+void check_matches_tree(int size, int seed) {
+    std::mt19937 gen(seed);
+    CompactBinaryTree<int, WT> tree;
+    BinaryTree<int, WT> real;
+    for (int i = 0; i < 4 * size; ++i) {
+        int x = gen() % size;
+        if (gen() % 3 == 0) {
+            ASSERT_EQ(tree.erase(x), real.erase(x));
+        } else {
+            ASSERT_EQ(tree.insert(x).second, real.insert(x).second);
+        }
+        ASSERT_EQ(tree.size(), real.size());
+        ASSERT_EQ(walk(tree), walk(real));
+        ASSERT_EQ(walk_backward(tree), walk(real));
+    }
+    CompactBinaryTree<int, WT> copy = tree;
+    ASSERT_EQ(copy, tree);
+    tree.clear();
+    ASSERT_TRUE(tree.empty());
+    ASSERT_EQ(tree.begin(), tree.end());
+    ASSERT_EQ(walk(copy), walk(real));
+}
+
+TEST(CompactTree, MatchesBinaryTree) {
+    check_matches_tree<WalkType::InOrder>(300, 1);
+    check_matches_tree<WalkType::PreOrder>(300, 2);
+    check_matches_tree<WalkType::PostOrder>(300, 3);
+}
+
+TEST(CompactTree, EraseReturnsNext) {
+    CompactBinaryTree<int, WalkType::PreOrder> tree{8, 4, 12, 2, 6, 10, 14, 9};
+    std::vector<int> seen;
+    for (auto it = tree.begin(); it != tree.end();) {
+        seen.push_back(*it);
+        it = tree.erase(it);
+    }
+    ASSERT_EQ(seen.size(), 8);
+    ASSERT_TRUE(tree.empty());
+}
+
+TEST(CompactTree, Lookup) {
+    CompactBinaryTree<std::string, WalkType::InOrder, std::less<>> tree{"b", "d", "a"};
+    ASSERT_EQ(*tree.find(std::string_view("b")), "b");
+    ASSERT_EQ(*tree.lower_bound(std::string_view("c")), "d");
+    ASSERT_EQ(tree.upper_bound(std::string_view("d")), tree.end());
+    ASSERT_EQ(tree.count("a"), 1);
+    ASSERT_FALSE(tree.contains(std::string_view("c")));
+}
+
+TEST(CompactTree, IteratorsSurviveGrowth) {
+    CompactBinaryTree<int> tree{0};
+    auto first = tree.begin();
+    for (int i = 1; i < 10000; ++i) {
+        tree.insert(i * 7919 % 10007);
+    }
+    ASSERT_EQ(*first, 0);
+    ASSERT_EQ(*++first, 1);
+    std::set<int> real(tree.begin(), tree.end());
+    ASSERT_EQ(real.size(), tree.size());
+}
+
+TEST(CompactTree, IteratorsSurviveSwapAndMove) {
+    CompactBinaryTree<int> left{1, 2, 3};
+    CompactBinaryTree<int> right{10, 20};
+    auto two = ++left.begin();
+    auto twenty = ++right.begin();
+    left.swap(right);
+    ASSERT_EQ(*two, 2);
+    ASSERT_EQ(*--two, 1);
+    ASSERT_EQ(*twenty, 20);
+    ASSERT_EQ(--twenty, left.begin());
+    CompactBinaryTree<int> moved(std::move(right));
+    ASSERT_EQ(*++two, 2);
+    ASSERT_EQ(++++two, moved.end());
+    CompactBinaryTree<int> assigned;
+    assigned = std::move(moved);
+    ASSERT_EQ(*--two, 3);
+    for (int i = 4; i < 1000; ++i) {
+        assigned.insert(i);
+    }
+    ASSERT_EQ(*++two, 4);
+}
+
+TEST(CompactTree, NodeSize) {
+    ASSERT_LE(sizeof(CompactNode<int>), 16);
+    ASSERT_LE(2 * sizeof(CompactNode<int>), sizeof(Node<int>));
+}
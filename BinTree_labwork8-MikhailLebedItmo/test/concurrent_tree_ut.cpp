@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "../lib/concurrent_tree.h"
+
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentTree, SingleThreadMatchesSet) {
+    ConcurrentBinaryTree<int> tree;
+    std::set<int> real;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 200);
+    for (int i = 0; i < 5000; ++i) {
+        int x = dist(gen);
+        if (gen() % 3 == 0) {
+            ASSERT_EQ(tree.erase(x), real.erase(x) == 1);
+        } else {
+            ASSERT_EQ(tree.insert(x), real.insert(x).second);
+        }
+        ASSERT_EQ(tree.size(), real.size());
+        int probe = dist(gen);
+        ASSERT_EQ(tree.contains(probe), real.contains(probe));
+        auto lb = real.lower_bound(probe);
+        ASSERT_EQ(tree.lower_bound(probe), lb == real.end() ? std::nullopt : std::optional<int>(*lb));
+        auto ub = real.upper_bound(probe);
+        ASSERT_EQ(tree.upper_bound(probe), ub == real.end() ? std::nullopt : std::optional<int>(*ub));
+    }
+    std::vector<int> my_res;
+    tree.for_each([&](int x) { my_res.push_back(x); });
+    ASSERT_EQ(my_res, std::vector<int>(real.begin(), real.end()));
+}
+
+TEST(ConcurrentTree, RoutingNode) {
+    ConcurrentBinaryTree<int> tree{5, 3, 8, 1, 4, 7, 9};
+    ASSERT_TRUE(tree.erase(5));
+    ASSERT_FALSE(tree.contains(5));
+    ASSERT_FALSE(tree.erase(5));
+    ASSERT_EQ(tree.lower_bound(5), 7);
+    ASSERT_EQ(tree.upper_bound(4), 7);
+    ASSERT_TRUE(tree.insert(5));
+    ASSERT_FALSE(tree.insert(5));
+    ASSERT_EQ(*tree.find(5), 5);
+    ASSERT_TRUE(tree.erase(5));
+    ASSERT_TRUE(tree.erase(3));
+    ASSERT_TRUE(tree.erase(1));
+    ASSERT_TRUE(tree.erase(4));
+    std::vector<int> my_res;
+    tree.for_each([&](int x) { my_res.push_back(x); });
+    ASSERT_EQ(my_res, std::vector<int>({7, 8, 9}));
+}
+
+TEST(ConcurrentTree, StressReadersAndWriters) {
+    const int writers = 4;
+    const int readers = 4;
+    const int key_range = 4000;
+    const int ops = 20000;
+    ConcurrentBinaryTree<int> tree;
+    // odd keys are inserted once and never erased, readers must always see them
+    for (int x = 1; x < key_range; x += 2) {
+        tree.insert(x);
+    }
+    std::vector<std::set<int>> expected(writers);
+    std::atomic<bool> stop = false;
+    std::atomic<int> failures = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < writers; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<int> dist(0, key_range / (2 * writers) - 1);
+            for (int i = 0; i < ops; ++i) {
+                int x = 2 * (dist(gen) * writers + t);
+                if (gen() % 2 == 0) {
+                    if (tree.insert(x) != expected[t].insert(x).second) {
+                        ++failures;
+                    }
+                } else {
+                    if (tree.erase(x) != (expected[t].erase(x) == 1)) {
+                        ++failures;
+                    }
+                }
+            }
+        });
+    }
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937 gen(100 + t);
+            std::uniform_int_distribution<int> dist(0, key_range / 2 - 1);
+            while (!stop.load()) {
+                int x = 2 * dist(gen) + 1;
+                if (!tree.contains(x) || tree.lower_bound(x) != x) {
+                    ++failures;
+                }
+                int prev = -1;
+                int odd_seen = 0;
+                tree.for_each([&](int y) {
+                    if (y <= prev) {
+                        ++failures;
+                    }
+                    odd_seen += y % 2;
+                    prev = y;
+                });
+                if (odd_seen != key_range / 2) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (int t = 0; t < writers; ++t) {
+        threads[t].join();
+    }
+    stop = true;
+    for (int t = writers; t < writers + readers; ++t) {
+        threads[t].join();
+    }
+
+    ASSERT_EQ(failures.load(), 0);
+    std::set<int> real;
+    for (int x = 1; x < key_range; x += 2) {
+        real.insert(x);
+    }
+    for (const auto& part: expected) {
+        real.insert(part.begin(), part.end());
+    }
+    std::vector<int> my_res;
+    tree.for_each([&](int x) { my_res.push_back(x); });
+    ASSERT_EQ(my_res, std::vector<int>(real.begin(), real.end()));
+    ASSERT_EQ(tree.size(), real.size());
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "../lib/persistent_tree.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+static size_t allocations = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        ++allocations;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    friend bool operator==(const CountingAllocator&, const CountingAllocator&) {
+        return true;
+    }
+};
+
+using persistent = PersistentBinaryTree<int>;
+
+TEST(PersistentTree, VersionsAreIndependent) {
+    persistent empty;
+    auto v1 = empty.insert(5).insert(3).insert(8);
+    auto v2 = v1.insert(4).erase(8);
+    ASSERT_TRUE(empty.empty());
+    ASSERT_EQ(std::vector<int>(v1.begin(), v1.end()), std::vector<int>({3, 5, 8}));
+    ASSERT_EQ(std::vector<int>(v2.begin(), v2.end()), std::vector<int>({3, 4, 5}));
+    ASSERT_EQ(v1.size(), 3);
+    ASSERT_EQ(v2.size(), 3);
+    ASSERT_EQ(v1.insert(5), v1);
+    ASSERT_EQ(v1.erase(100).size(), 3);
+}
+
+TEST(PersistentTree, SnapshotKeepsContents) {
+    persistent tree{5, 1, 9, 10, -1, 15, 9, 33};
+    auto snapshot = tree.snapshot();
+    for (int x = 100; x < 200; ++x) {
+        tree = tree.insert(x);
+    }
+    tree = tree.erase(5).erase(33);
+    ASSERT_EQ(std::vector<int>(snapshot.begin(), snapshot.end()), std::vector<int>({-1, 1, 5, 9, 10, 15, 33}));
+    ASSERT_EQ(tree.size(), 105);
+    ASSERT_FALSE(tree.contains(5));
+    ASSERT_TRUE(snapshot.contains(5));
+}
+
+TEST(PersistentTree, MatchesSet) {
+    persistent tree;
+    std::set<int> real;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 500);
+    for (int i = 0; i < 5000; ++i) {
+        int x = dist(gen);
+        if (gen() % 3 == 0) {
+            tree = tree.erase(x);
+            real.erase(x);
+        } else {
+            tree = tree.insert(x);
+            real.insert(x);
+        }
+        int probe = dist(gen);
+        auto lb = real.lower_bound(probe);
+        auto my_lb = tree.lower_bound(probe);
+        ASSERT_EQ(lb == real.end(), my_lb == tree.end());
+        if (lb != real.end()) {
+            ASSERT_EQ(*lb, *my_lb);
+        }
+        auto ub = real.upper_bound(probe);
+        auto my_ub = tree.upper_bound(probe);
+        ASSERT_EQ(ub == real.end(), my_ub == tree.end());
+        if (ub != real.end()) {
+            ASSERT_EQ(*ub, *my_ub);
+        }
+    }
+    ASSERT_EQ(tree.size(), real.size());
+    ASSERT_TRUE(std::equal(tree.begin(), tree.end(), real.begin(), real.end()));
+    ASSERT_TRUE(std::equal(tree.rbegin(), tree.rend(), real.rbegin(), real.rend()));
+}
+
+TEST(PersistentTree, PathCopying) {
+    using counted = PersistentBinaryTree<int, std::less<int>, CountingAllocator<int>>;
+    const int n = 1 << 14;
+    std::vector<int> data(n);
+    for (int i = 0; i < n; ++i) {
+        data[i] = i;
+    }
+    std::shuffle(data.begin(), data.end(), std::mt19937(1));
+    counted tree;
+    for (auto x: data) {
+        tree = tree.insert(x);
+    }
+    allocations = 0;
+    auto snapshot = tree.snapshot();
+    ASSERT_EQ(allocations, 0);
+    auto inserted = tree.insert(n);
+    auto erased = tree.erase(n / 2);
+    ASSERT_LT(allocations, 200);
+    ASSERT_EQ(snapshot.size(), n);
+    ASSERT_EQ(inserted.size(), n + 1);
+    ASSERT_EQ(erased.size(), n - 1);
+}
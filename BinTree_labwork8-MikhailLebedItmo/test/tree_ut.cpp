@@ -2,8 +2,17 @@
 #include <exception>
 #include <gtest/gtest.h>
 #include "../lib/tree.h"
+#include "../lib/tree_dump.h"
 #include <gmock/gmock.h>
 #include <vector>
+#include <algorithm>
+#include <random>
+#include <numeric>
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
 
 using pre_o = BinaryTree<int, WalkType::PreOrder>;
 using post_o = BinaryTree<int, WalkType::PostOrder>;
@@ -123,4 +132,824 @@ TEST(Compare, Unless) {
     }
     ASSERT_EQ(it_s, s.end());
     ASSERT_EQ(it_t, t.end());
-}
\ No newline at end of file
+}
+
+template <typename Tree>
+std::vector<int> to_vector(const Tree& tree) {
+    std::vector<int> result;
+    for (auto x: tree) {
+        result.push_back(x);
+    }
+    return result;
+}
+
+TEST(SplitJoin, InOrdered) {
+    in_o tree{5, 1, 9, 10, -1, 15, 9, 33, 7};
+    auto right = tree.split(9);
+    ASSERT_EQ(to_vector(tree), std::vector<int>({-1, 1, 5, 7}));
+    ASSERT_EQ(to_vector(right), std::vector<int>({9, 10, 15, 33}));
+    ASSERT_EQ(tree.size(), 4);
+    ASSERT_EQ(right.size(), 4);
+    tree.join(right);
+    ASSERT_EQ(to_vector(tree), std::vector<int>({-1, 1, 5, 7, 9, 10, 15, 33}));
+    ASSERT_EQ(tree.size(), 8);
+    ASSERT_TRUE(right.empty());
+    ASSERT_EQ(right.begin(), right.end());
+}
+
+TEST(SplitJoin, PreOrdered) {
+    pre_o tree{5, 3, 1, 4, 7, 10, 6};
+    auto right = tree.split(5);
+    ASSERT_EQ(to_vector(tree), std::vector<int>({3, 1, 4}));
+    ASSERT_EQ(to_vector(right), std::vector<int>({5, 7, 6, 10}));
+    tree.join(right);
+    ASSERT_EQ(tree.size(), 7);
+    ASSERT_EQ(*tree.find(6), 6);
+    tree.erase(6);
+    ASSERT_EQ(tree.find(6), tree.end());
+}
+
+TEST(SplitJoin, PostOrdered) {
+    post_o tree{5, 3, 1, 4, 7, 10, 6};
+    auto right = tree.split(100);
+    ASSERT_TRUE(right.empty());
+    ASSERT_EQ(to_vector(tree), std::vector<int>({1, 4, 3, 6, 10, 7, 5}));
+    auto all = tree.split(-100);
+    ASSERT_TRUE(tree.empty());
+    ASSERT_EQ(to_vector(all), std::vector<int>({1, 4, 3, 6, 10, 7, 5}));
+}
+
+template <typename Tree>
+std::vector<int> to_sorted_vector(const Tree& tree) {
+    auto result = to_vector(tree);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+template <typename Tree>
+void check_set_operations(int size, int range, int seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(0, range);
+    std::vector<int> a_data(size);
+    std::vector<int> b_data(size / 3);
+    for (auto& x: a_data) {
+        x = dist(gen);
+    }
+    for (auto& x: b_data) {
+        x = dist(gen);
+    }
+    Tree a(a_data.begin(), a_data.end());
+    Tree b(b_data.begin(), b_data.end());
+    auto a_sorted = to_sorted_vector(a);
+    auto b_sorted = to_sorted_vector(b);
+
+    std::vector<int> real;
+    std::set_union(a_sorted.begin(), a_sorted.end(), b_sorted.begin(), b_sorted.end(), std::back_inserter(real));
+    Tree united = a;
+    Tree other = b;
+    united.unite(other);
+    ASSERT_EQ(to_sorted_vector(united), real);
+    ASSERT_EQ(united.size(), real.size());
+    ASSERT_TRUE(other.empty());
+
+    real.clear();
+    std::set_intersection(a_sorted.begin(), a_sorted.end(), b_sorted.begin(), b_sorted.end(), std::back_inserter(real));
+    Tree intersected = b;
+    other = a;
+    intersected.intersect(other);
+    ASSERT_EQ(to_sorted_vector(intersected), real);
+    ASSERT_EQ(intersected.size(), real.size());
+
+    real.clear();
+    std::set_difference(a_sorted.begin(), a_sorted.end(), b_sorted.begin(), b_sorted.end(), std::back_inserter(real));
+    Tree subtracted = a;
+    other = b;
+    subtracted.subtract(other);
+    ASSERT_EQ(to_sorted_vector(subtracted), real);
+    ASSERT_EQ(subtracted.size(), real.size());
+}
+
+TEST(SetOperations, Small) {
+    check_set_operations<in_o>(50, 60, 1);
+    check_set_operations<pre_o>(50, 60, 2);
+    check_set_operations<post_o>(50, 60, 3);
+}
+
+TEST(SetOperations, Large) {
+    check_set_operations<in_o>(150000, 400000, 4);
+}
+
+in_o make_chain(int limit, int step) {
+    // sorted inserts make a chain as deep as the tree is large
+    in_o tree;
+    for (int i = 0; i < limit; i += step) {
+        tree.insert(tree.cend(), i);
+    }
+    return tree;
+}
+
+TEST(SplitJoin, LongChain) {
+    in_o tree = make_chain(2000000, 1);
+    auto right = tree.split(1900000);
+    ASSERT_EQ(tree.size(), 1900000);
+    ASSERT_EQ(right.size(), 100000);
+    ASSERT_EQ(*right.begin(), 1900000);
+    ASSERT_EQ(*--tree.end(), 1899999);
+    tree.join(right);
+    ASSERT_EQ(tree.size(), 2000000);
+    ASSERT_EQ(*--tree.end(), 1999999);
+}
+
+TEST(SetOperations, LongChains) {
+    const int limit = 600000;
+    auto expected = [limit](auto keep) {
+        std::vector<int> result;
+        for (int i = 0; i < limit; ++i) {
+            if (keep(i)) {
+                result.push_back(i);
+            }
+        }
+        return result;
+    };
+    in_o united = make_chain(limit, 2);
+    in_o other = make_chain(limit, 3);
+    united.unite(other);
+    ASSERT_TRUE(other.empty());
+    ASSERT_EQ(to_vector(united), expected([](int i){return i % 2 == 0 || i % 3 == 0;}));
+    ASSERT_EQ(united.size(), 400000);
+
+    in_o intersected = make_chain(limit, 2);
+    other = make_chain(limit, 3);
+    intersected.intersect(other);
+    ASSERT_EQ(to_vector(intersected), expected([](int i){return i % 6 == 0;}));
+    ASSERT_EQ(intersected.size(), 100000);
+
+    in_o subtracted = make_chain(limit, 2);
+    other = make_chain(limit, 3);
+    subtracted.subtract(other);
+    ASSERT_EQ(to_vector(subtracted), expected([](int i){return i % 2 == 0 && i % 3 != 0;}));
+    ASSERT_EQ(subtracted.size(), 200000);
+}
+
+TEST(Lookup, Bounds) {
+    in_o tree{5, 1, 9, 3, 7};
+    ASSERT_EQ(*tree.lower_bound(4), 5);
+    ASSERT_EQ(*tree.lower_bound(5), 5);
+    ASSERT_EQ(*tree.upper_bound(5), 7);
+    ASSERT_EQ(tree.lower_bound(10), tree.end());
+    ASSERT_EQ(tree.count(3), 1);
+    ASSERT_EQ(tree.count(4), 0);
+    ASSERT_TRUE(tree.contains(9));
+    ASSERT_FALSE(tree.contains(0));
+    ASSERT_TRUE(tree.value_comp()(1, 2));
+}
+
+TEST(Map, Basic) {
+    BinaryMap<int, std::string> map;
+    map[3] = "three";
+    map[1] = "one";
+    map.insert({2, "two"});
+    ASSERT_FALSE(map.insert({2, "other"}).second);
+    ASSERT_EQ(map.at(2), "two");
+    ASSERT_EQ(map.find(3)->second, "three");
+    ASSERT_THROW(map.at(4), std::out_of_range);
+    std::vector<int> keys;
+    for (const auto& [key, value]: map) {
+        keys.push_back(key);
+    }
+    ASSERT_EQ(keys, std::vector<int>({1, 2, 3}));
+    ASSERT_EQ(map.erase(1), 1);
+    ASSERT_EQ(map.size(), 2);
+}
+
+TEST(Multiset, Duplicates) {
+    BinaryMultiset<int> tree{5, 3, 5, 1, 5, 3};
+    ASSERT_EQ(to_vector(tree), std::vector<int>({1, 3, 3, 5, 5, 5}));
+    ASSERT_EQ(tree.count(5), 3);
+    auto [first, last] = tree.equal_range(3);
+    ASSERT_EQ(*first, 3);
+    ASSERT_EQ(*last, 5);
+    ASSERT_EQ(tree.erase(5), 3);
+    ASSERT_EQ(to_vector(tree), std::vector<int>({1, 3, 3}));
+}
+
+TEST(Multimap, KeepsInsertionOrder) {
+    BinaryMultimap<int, int> map;
+    map.insert({1, 10});
+    map.insert({0, 0});
+    map.insert({1, 11});
+    map.insert({1, 12});
+    std::vector<int> values;
+    for (auto it = map.lower_bound(1); it != map.upper_bound(1); ++it) {
+        values.push_back(it->second);
+    }
+    ASSERT_EQ(values, std::vector<int>({10, 11, 12}));
+}
+
+TEST(Lookup, Transparent) {
+    // std::string is not implicitly constructible from std::string_view,
+    // so these calls compile only if no temporary key is built
+    BinaryTree<std::string, WalkType::InOrder, std::less<>> tree{"b", "a", "c"};
+    std::string_view probe = "b";
+    ASSERT_EQ(*tree.find(probe), "b");
+    ASSERT_TRUE(tree.contains(probe));
+    ASSERT_EQ(tree.count(std::string_view("d")), 0);
+    ASSERT_EQ(*tree.upper_bound(probe), "c");
+    BinaryMap<std::string, int, WalkType::InOrder, std::less<>> map;
+    map["key"] = 1;
+    ASSERT_EQ(map.find(std::string_view("key"))->second, 1);
+}
+
+// a copy recomputes begin and end from scratch, so the walk of the
+// original must match it if the incremental updates were right
+template <typename Tree>
+void check_hinted_insert(int size, int seed) {
+    std::mt19937 gen(seed);
+    Tree tree;
+    std::set<int> real;
+    for (int i = 0; i < size; ++i) {
+        tree.insert(tree.end(), i);
+        real.insert(i);
+    }
+    for (int i = 0; i < size; ++i) {
+        int x = gen() % (4 * size) - size;
+        auto hint = gen() % 2 ? tree.find(x + 1) : tree.begin();
+        auto it = tree.insert(hint, x);
+        ASSERT_EQ(*it, x);
+        real.insert(x);
+        ASSERT_EQ(tree.size(), real.size());
+    }
+    ASSERT_EQ(to_sorted_vector(tree), std::vector<int>(real.begin(), real.end()));
+    ASSERT_EQ(to_vector(tree), to_vector(Tree(tree)));
+}
+
+TEST(HintedInsert, AllOrders) {
+    check_hinted_insert<in_o>(1000, 1);
+    check_hinted_insert<pre_o>(1000, 2);
+    check_hinted_insert<post_o>(1000, 3);
+}
+
+TEST(HintedInsert, SortedIngestCost) {
+    using counted = BinaryTree<int, WalkType::InOrder, std::less<int>, std::allocator<int>, StatsTraits<SetTraits<int>>>;
+    const int size = 20000;
+    counted ascending;
+    counted descending;
+    for (int i = 0; i < size; ++i) {
+        ascending.insert(ascending.cend(), i);
+        descending.insert(descending.cbegin(), size - 1 - i);
+    }
+    // a correct hint at either end costs O(1) per insert
+    for (const auto& stats: {ascending.stats(), descending.stats()}) {
+        ASSERT_LT(stats.node_visits + stats.comparisons, 4 * size);
+    }
+    ASSERT_EQ(to_vector(ascending), to_vector(descending));
+    ASSERT_EQ(to_vector(descending).size(), size);
+}
+
+TEST(HintedInsert, Emplace) {
+    BinaryMap<int, std::string> map{{1, "one"}, {3, "three"}};
+    auto it = map.emplace_hint(map.find(3), 2, "two");
+    ASSERT_EQ(it->second, "two");
+    it = map.emplace_hint(map.end(), 2, "other");
+    ASSERT_EQ(it->second, "two");
+    ASSERT_EQ(map.size(), 3);
+}
+
+template <typename Tree>
+void check_insert_batch(int size, int seed) {
+    std::mt19937 gen(seed);
+    Tree tree;
+    std::set<int> real;
+    for (int round = 0; round < 4; ++round) {
+        std::vector<int> batch;
+        for (int i = 0; i < size; ++i) {
+            batch.push_back(gen() % (2 * size));
+        }
+        size_t before = real.size();
+        real.insert(batch.begin(), batch.end());
+        ASSERT_EQ(tree.insert_batch(batch), real.size() - before);
+        ASSERT_EQ(tree.size(), real.size());
+    }
+    ASSERT_EQ(to_sorted_vector(tree), std::vector<int>(real.begin(), real.end()));
+    ASSERT_EQ(to_vector(tree), to_vector(Tree(tree)));
+}
+
+TEST(InsertBatch, AllOrders) {
+    check_insert_batch<in_o>(500, 1);
+    check_insert_batch<pre_o>(500, 2);
+    check_insert_batch<post_o>(500, 3);
+}
+
+TEST(InsertBatch, Stable) {
+    BinaryMultimap<int, char> map;
+    std::vector<std::pair<int, char>> batch{{1, 'a'}, {0, 'b'}, {1, 'c'}, {0, 'd'}};
+    ASSERT_EQ(map.insert_batch(batch), 4);
+    std::string values;
+    for (const auto& [key, value]: map) {
+        values += value;
+    }
+    ASSERT_EQ(values, "bdac");
+}
+
+template <WalkType WT>
+void check_threaded(int size, int seed) {
+    std::mt19937 gen(seed);
+    ThreadedBinaryTree<int, WT> tree;
+    BinaryTree<int, WT> real;
+    for (int i = 0; i < 4 * size; ++i) {
+        int x = gen() % size;
+        if (gen() % 3 == 0) {
+            ASSERT_EQ(tree.erase(x), real.erase(x));
+        } else if (gen() % 2 == 0) {
+            tree.insert(x);
+            real.insert(x);
+        } else {
+            tree.insert(tree.lower_bound(x), x);
+            real.insert(real.lower_bound(x), x);
+        }
+        ASSERT_EQ(to_vector(tree), to_vector(real));
+    }
+    std::vector<int> backward;
+    for (auto it = tree.end(); it != tree.begin();) {
+        backward.push_back(*--it);
+    }
+    std::reverse(backward.begin(), backward.end());
+    ASSERT_EQ(backward, to_vector(real));
+
+    auto right = tree.split(size / 2);
+    auto real_right = real.split(size / 2);
+    ASSERT_EQ(to_vector(tree), to_vector(real));
+    ASSERT_EQ(to_vector(right), to_vector(real_right));
+    tree.join(right);
+    real.join(real_right);
+    ASSERT_EQ(to_vector(tree), to_vector(real));
+    ThreadedBinaryTree<int, WT> copy = tree;
+    ASSERT_EQ(to_vector(copy), to_vector(real));
+    tree.clear();
+    ASSERT_EQ(tree.begin(), tree.end());
+}
+
+TEST(Threaded, AllOrders) {
+    check_threaded<WalkType::InOrder>(200, 1);
+    check_threaded<WalkType::PreOrder>(200, 2);
+    check_threaded<WalkType::PostOrder>(200, 3);
+}
+
+template <typename Tree>
+void check_partition(int size, size_t k, int seed) {
+    std::mt19937 gen(seed);
+    Tree tree;
+    for (int i = 0; i < size; ++i) {
+        tree.insert(gen() % (4 * size));
+    }
+    std::vector<std::pair<typename Tree::const_iterator, typename Tree::const_iterator>> parts;
+    tree.partition(k, std::back_inserter(parts));
+    ASSERT_EQ(parts.size(), std::min(k, tree.size()));
+    std::vector<int> joined;
+    for (auto [first, last]: parts) {
+        size_t count = 0;
+        for (; first != last; ++first, ++count) {
+            joined.push_back(*first);
+        }
+        ASSERT_GE(count, tree.size() / k);
+        ASSERT_LE(count, tree.size() / k + 1);
+    }
+    ASSERT_EQ(joined, to_vector(tree));
+}
+
+TEST(Parallel, Partition) {
+    check_partition<in_o>(10000, 7, 1);
+    check_partition<pre_o>(10000, 8, 2);
+    check_partition<post_o>(10000, 3, 3);
+    check_partition<in_o>(5, 8, 4);
+}
+
+TEST(Parallel, PartitionRange) {
+    in_o tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert(i * 7919 % 1000);
+    }
+    std::vector<std::pair<in_o::const_iterator, in_o::const_iterator>> parts;
+    tree.partition(tree.lower_bound(100), tree.upper_bound(899), 4, std::back_inserter(parts));
+    ASSERT_EQ(parts.size(), 4);
+    int expected = 100;
+    for (auto [first, last]: parts) {
+        for (int count = 0; first != last; ++first, ++count) {
+            ASSERT_EQ(*first, expected++);
+            ASSERT_LT(count, 200);
+        }
+    }
+    ASSERT_EQ(expected, 900);
+}
+
+TEST(Parallel, ForEachAndReduce) {
+    std::mt19937 gen(5);
+    in_o tree;
+    post_o post_tree;
+    for (int i = 0; i < 200000; ++i) {
+        int x = gen() % 1000000;
+        tree.insert(x);
+        post_tree.insert(x);
+    }
+    std::atomic<long long> sum = 0;
+    tree.parallel_for_each([&](int x) { sum += x; }, 4);
+    auto values = to_vector(tree);
+    ASSERT_EQ(sum.load(), std::accumulate(values.begin(), values.end(), 0LL));
+    auto add = [](long long acc, long long x) { return acc + x; };
+    ASSERT_EQ(tree.parallel_reduce(0LL, add, add, 4), sum.load());
+    // concatenation is not commutative, so this checks the order of parts
+    auto append = [](std::vector<int> acc, int x) { acc.push_back(x); return acc; };
+    auto concat = [](std::vector<int> acc, std::vector<int> part) {
+        acc.insert(acc.end(), part.begin(), part.end());
+        return acc;
+    };
+    ASSERT_EQ(post_tree.parallel_reduce(std::vector<int>(), append, concat, 4), to_vector(post_tree));
+    auto first = tree.lower_bound(1000);
+    auto last = tree.lower_bound(500000);
+    long long expected = 0;
+    for (auto it = first; it != last; ++it) {
+        expected += *it;
+    }
+    ASSERT_EQ(tree.parallel_reduce(first, last, 0LL, add, add, 3), expected);
+}
+
+TEST(Parallel, RangesOnChains) {
+    // sorted inserts at either end make a right and a left chain
+    const int size = 1000000;
+    in_o right_chain;
+    in_o left_chain;
+    for (int i = 0; i < size; ++i) {
+        right_chain.insert(right_chain.cend(), i);
+        left_chain.insert(left_chain.cbegin(), size - 1 - i);
+    }
+    auto add = [](long long acc, long long x) { return acc + x; };
+    for (in_o* tree: {&right_chain, &left_chain}) {
+        ASSERT_EQ(tree->parallel_reduce(tree->find(size - 10), tree->end(), 0LL, add, add, 4),
+                  10LL * size - 55);
+        ASSERT_EQ(tree->parallel_reduce(tree->find(5), tree->find(10), 0LL, add, add, 4), 35);
+        std::atomic<long long> sum = 0;
+        tree->parallel_for_each(tree->begin(), tree->find(10), [&](int x) { sum += x; }, 4);
+        ASSERT_EQ(sum.load(), 45);
+        std::vector<std::pair<in_o::const_iterator, in_o::const_iterator>> parts;
+        tree->partition(tree->find(size - 100), tree->end(), 4, std::back_inserter(parts));
+        ASSERT_FALSE(parts.empty());
+        ASSERT_EQ(*parts.front().first, size - 100);
+        ASSERT_EQ(parts.back().second, tree->end());
+    }
+}
+
+TEST(Dump, SaveLoad) {
+    std::mt19937 gen(6);
+    pre_o tree;
+    for (int i = 0; i < 10000; ++i) {
+        tree.insert(gen() % 100000);
+    }
+    std::string path = ::testing::TempDir() + "tree_dump.bin";
+    ASSERT_TRUE(tree.save(path));
+    in_o loaded{1, 2, 3};
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(loaded.size(), tree.size());
+    ASSERT_EQ(to_vector(loaded), to_sorted_vector(tree));
+    // a sorted file still gives a shallow tree
+    auto right = loaded.split(50000);
+    ASSERT_EQ(loaded.size() + right.size(), tree.size());
+
+    post_o post_loaded;
+    ASSERT_TRUE(post_loaded.load(path));
+    ASSERT_EQ(to_sorted_vector(post_loaded), to_sorted_vector(tree));
+    ASSERT_EQ(to_vector(post_loaded), to_vector(post_o(post_loaded)));
+
+    BinaryTree<long long> wrong_type;
+    ASSERT_FALSE(wrong_type.load(path));
+    ASSERT_TRUE(wrong_type.empty());
+    ASSERT_FALSE(loaded.load(path + ".missing"));
+    std::remove(path.c_str());
+}
+
+TEST(Dump, Multimap) {
+    BinaryMultimap<int, double> map;
+    map.insert({2, 0.5});
+    map.insert({1, 1.5});
+    map.insert({2, 2.5});
+    std::string path = ::testing::TempDir() + "multimap_dump.bin";
+    ASSERT_TRUE(map.save(path));
+    BinaryMultimap<int, double> loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(loaded.count(2), 2);
+    std::vector<double> values;
+    for (const auto& [key, value]: loaded) {
+        values.push_back(value);
+    }
+    ASSERT_EQ(values, std::vector<double>({1.5, 0.5, 2.5}));
+    std::remove(path.c_str());
+}
+
+TEST(Dump, BadCount) {
+    in_o tree{1, 2, 3};
+    std::string path = ::testing::TempDir() + "bad_count_dump.bin";
+    ASSERT_TRUE(tree.save(path));
+    // 4 * count wraps around to the 12 bytes that are really there
+    uint64_t count = 3 + (uint64_t(1) << 62);
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(TreeDump::Header, count));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    in_o loaded;
+    ASSERT_FALSE(loaded.load(path));
+    ASSERT_TRUE(loaded.empty());
+    count = 4;
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offsetof(TreeDump::Header, count));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    ASSERT_FALSE(loaded.load(path));
+    std::remove(path.c_str());
+}
+
+struct Blob {
+    int key;
+    char payload[100000];
+};
+
+struct BlobLess {
+    bool operator()(const Blob& left, const Blob& right) const {
+        return left.key < right.key;
+    }
+};
+
+TEST(Dump, LargeElements) {
+    // every element is larger than the write buffer
+    BinaryTree<Blob, WalkType::InOrder, BlobLess> tree;
+    auto blob = std::make_unique<Blob>();
+    for (int key: {3, 1, 2}) {
+        blob->key = key;
+        std::fill(std::begin(blob->payload), std::end(blob->payload), char('a' + key));
+        tree.insert(*blob);
+    }
+    std::string path = ::testing::TempDir() + "blob_dump.bin";
+    ASSERT_TRUE(tree.save(path));
+    BinaryTree<Blob, WalkType::InOrder, BlobLess> loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(loaded.size(), 3);
+    int key = 1;
+    for (const auto& value: loaded) {
+        ASSERT_EQ(value.key, key);
+        ASSERT_EQ(value.payload[99999], char('a' + key));
+        ++key;
+    }
+    std::remove(path.c_str());
+}
+
+TEST(Stats, Counters) {
+    using counted = BinaryTree<int, WalkType::InOrder, std::less<int>, std::allocator<int>, StatsTraits<SetTraits<int>>>;
+    counted tree{4, 2, 6};
+    ASSERT_EQ(tree.stats().allocations, 3);
+    tree.reset_stats();
+    tree.find(6);
+    auto stats = tree.stats();
+    ASSERT_EQ(stats.node_visits, 2);
+    ASSERT_EQ(stats.comparisons, 4);
+    tree.erase(4);
+    ASSERT_EQ(tree.stats().deallocations, 1);
+    ASSERT_EQ(tree.stats().relinks, 1);
+    counted copy(tree);
+    ASSERT_EQ(copy.stats().allocations, 2);
+    ASSERT_EQ(BinaryTree<int>({1, 2}).stats().allocations, 0);
+}
+
+TEST(Stats, Shape) {
+    BinaryTree<int, WalkType::PreOrder> tree{4, 2, 6, 1, 3, 5, 7};
+    auto shape = tree.shape_stats();
+    ASSERT_EQ(shape.height, 3);
+    ASSERT_DOUBLE_EQ(shape.average_depth, 10.0 / 7);
+    ASSERT_EQ(shape.balance[0], 7);
+
+    BinaryTree<int> chain;
+    for (int i = 0; i < 20000; ++i) {
+        chain.insert(chain.end(), i);
+    }
+    shape = chain.shape_stats();
+    ASSERT_EQ(shape.height, 20000);
+    ASSERT_DOUBLE_EQ(shape.average_depth, 19999.0 / 2);
+    ASSERT_EQ(shape.balance[0], 1);
+    ASSERT_EQ(shape.balance[1], 1);
+    ASSERT_EQ(shape.balance[ShapeStats::kBalanceBuckets - 1], 20000 - ShapeStats::kBalanceBuckets + 1);
+    ASSERT_EQ(BinaryTree<int>().shape_stats().height, 0);
+}
+
+template <typename Iterator>
+Iterator advanced(Iterator it, size_t steps) {
+    for (size_t i = 0; i < steps; ++i) {
+        ++it;
+    }
+    return it;
+}
+
+// erasing a node with two children moves its successor into its place, so
+// pre- and post-order walks of the rest may change and only the contents
+// are compared for them
+template <typename Tree, bool keeps_order>
+void check_erase_range(int seed) {
+    std::mt19937 gen(seed);
+    for (int round = 0; round < 50; ++round) {
+        Tree tree;
+        for (int i = 0; i < 200; ++i) {
+            tree.insert(gen() % 300);
+        }
+        auto expected = to_vector(tree);
+        size_t from = gen() % (expected.size() + 1);
+        size_t to = from + gen() % (expected.size() - from + 1);
+        auto last = advanced(tree.begin(), to);
+        ASSERT_EQ(tree.erase(advanced(tree.begin(), from), last), last);
+        expected.erase(expected.begin() + from, expected.begin() + to);
+        int divisor = 2 + round % 3;
+        size_t odd = std::count_if(expected.begin(), expected.end(), [&](int x) { return x % divisor; });
+        ASSERT_EQ(tree.erase_if([&](int x) { return x % divisor != 0; }), odd);
+        std::erase_if(expected, [&](int x) { return x % divisor; });
+        ASSERT_EQ(tree.size(), expected.size());
+        if constexpr(keeps_order) {
+            ASSERT_EQ(to_vector(tree), expected);
+        }
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(to_sorted_vector(tree), expected);
+        tree.insert(1);
+        ASSERT_TRUE(tree.contains(1));
+    }
+}
+
+TEST(EraseRange, AllOrders) {
+    check_erase_range<BinaryTree<int>, true>(1);
+    check_erase_range<BinaryTree<int, WalkType::PreOrder>, false>(2);
+    check_erase_range<BinaryTree<int, WalkType::PostOrder>, false>(3);
+    check_erase_range<BinaryMultiset<int>, true>(4);
+    check_erase_range<ThreadedBinaryTree<int>, true>(5);
+    check_erase_range<ThreadedBinaryTree<int, WalkType::PreOrder>, false>(6);
+}
+
+TEST(EraseRange, KeyRangeCost) {
+    using counted = BinaryTree<int, WalkType::InOrder, std::less<int>, std::allocator<int>, StatsTraits<SetTraits<int>>>;
+    counted tree;
+    for (int i = 0; i < 1024; ++i) {
+        tree.insert(i * 37 % 1024);
+    }
+    tree.reset_stats();
+    tree.erase(tree.find(100), tree.find(200));
+    ASSERT_EQ(tree.stats().deallocations, 100);
+    ASSERT_LT(tree.stats().comparisons, 200);
+    ASSERT_EQ(tree.size(), 924);
+    ASSERT_EQ(*tree.lower_bound(100), 200);
+}
+
+TEST(EraseRange, DeepClear) {
+    BinaryTree<int, WalkType::PostOrder> chain;
+    for (int i = 0; i < 1000000; ++i) {
+        chain.insert(chain.end(), i);
+    }
+    ASSERT_EQ(chain.size(), 1000000);
+    chain.clear();
+    ASSERT_TRUE(chain.empty());
+    ASSERT_EQ(chain.begin(), chain.end());
+}
+
+// leaves leave the walk of the rest as it was, in bulk as well as one by one
+template <typename Tree>
+void check_erase_leaves() {
+    Tree bulk{5, 3, 1, 4, 7, 10, 6, 8, 9, 2};
+    Tree single = bulk;
+    auto expected = to_vector(bulk);
+    std::erase_if(expected, [](int x) { return x == 9 || x == 2; });
+    ASSERT_EQ(bulk.erase_if([](int x) { return x == 9 || x == 2; }), 2);
+    single.erase(9);
+    single.erase(2);
+    ASSERT_EQ(to_vector(bulk), expected);
+    ASSERT_EQ(to_vector(single), expected);
+    // 1 and 4 follow each other in both walks
+    auto first = bulk.find(1);
+    auto last = first;
+    ASSERT_EQ(*++last, 4);
+    ++last;
+    ASSERT_EQ(bulk.erase(first, last), last);
+    std::erase_if(expected, [](int x) { return x == 1 || x == 4; });
+    ASSERT_EQ(to_vector(bulk), expected);
+}
+
+TEST(EraseRange, LeavesKeepWalk) {
+    check_erase_leaves<BinaryTree<int, WalkType::PreOrder>>();
+    check_erase_leaves<BinaryTree<int, WalkType::PostOrder>>();
+}
+
+TEST(EraseRange, EraseIfChain) {
+    BinaryTree<int, WalkType::PostOrder> chain;
+    for (int i = 0; i < 1000000; ++i) {
+        chain.insert(chain.end(), i);
+    }
+    auto expected = to_vector(chain);
+    std::erase_if(expected, [](int x) { return x % 3 != 0; });
+    ASSERT_EQ(chain.erase_if([](int x) { return x % 3 != 0; }), 666666);
+    ASSERT_EQ(chain.size(), 333334);
+    ASSERT_EQ(to_vector(chain), expected);
+    chain.erase(chain.begin(), chain.end());
+    ASSERT_TRUE(chain.empty());
+}
+
+TEST(EraseRange, EraseIfAugmented) {
+    // a per-node erase refreshes the whole path above the node on a chain
+    IntervalBinaryTree<int> tree;
+    for (int i = 0; i < 10000; ++i) {
+        tree.insert(tree.cend(), {i, i + 5});
+    }
+    ASSERT_EQ(tree.erase_if([](const auto& interval) { return interval.first % 100 != 0; }), 9900);
+    std::vector<IntervalBinaryTree<int>::const_iterator> found;
+    tree.overlapping(1000, 1003, std::back_inserter(found));
+    ASSERT_EQ(found.size(), 1);
+    ASSERT_EQ(found[0]->first, 1000);
+}
+
+template <WalkType WT>
+void check_intervals(int seed) {
+    std::mt19937 gen(seed);
+    IntervalBinaryTree<int, WT> tree;
+    std::vector<std::pair<int, int>> all;
+    for (int i = 0; i < 300; ++i) {
+        int start = gen() % 1000;
+        std::pair<int, int> interval(start, start + gen() % 50);
+        tree.insert(interval);
+        all.push_back(interval);
+        if (i % 5 == 0) {
+            auto victim = all[gen() % all.size()];
+            tree.erase(tree.find(victim));
+            all.erase(std::find(all.begin(), all.end(), victim));
+        }
+    }
+    std::sort(all.begin(), all.end());
+    for (int query = 0; query < 200; ++query) {
+        int lo = gen() % 1100;
+        int hi = lo + gen() % 3 * (gen() % 30);
+        std::vector<typename IntervalBinaryTree<int, WT>::const_iterator> found;
+        tree.overlapping(lo, hi, std::back_inserter(found));
+        std::vector<std::pair<int, int>> result;
+        for (auto it: found) {
+            result.push_back(*it);
+        }
+        std::vector<std::pair<int, int>> expected;
+        for (auto interval: all) {
+            if (interval.first <= hi && lo <= interval.second) {
+                expected.push_back(interval);
+            }
+        }
+        ASSERT_EQ(result, expected);
+    }
+}
+
+TEST(Augment, Intervals) {
+    check_intervals<WalkType::InOrder>(1);
+    check_intervals<WalkType::PreOrder>(2);
+    check_intervals<WalkType::PostOrder>(3);
+}
+
+TEST(Augment, RangeSum) {
+    std::mt19937 gen(7);
+    AggregateBinaryMap<int, long long> map;
+    std::map<int, long long> real;
+    for (int i = 0; i < 2000; ++i) {
+        int key = gen() % 500;
+        long long value = gen() % 100;
+        if (gen() % 4 == 0) {
+            map.erase(key);
+            real.erase(key);
+        } else {
+            map.insert_or_assign(key, value);
+            real[key] = value;
+        }
+        int lo = gen() % 500;
+        int hi = lo + gen() % 100;
+        long long sum = 0;
+        for (auto it = real.lower_bound(lo); it != real.end() && it->first < hi; ++it) {
+            sum += it->second;
+        }
+        ASSERT_EQ(map.reduce(lo, hi).value_or(0), sum);
+    }
+    auto copy = map;
+    auto right = copy.split(250);
+    ASSERT_EQ(copy.reduce(0, 500).value_or(0) + right.reduce(0, 500).value_or(0), map.reduce(0, 500).value_or(0));
+    copy.erase(copy.lower_bound(100), copy.end());
+    ASSERT_EQ(copy.reduce(0, 500).value_or(0), map.reduce(0, 100).value_or(0));
+    copy.join(right);
+    auto total = map.reduce(0, 500);
+    copy.unite(map);
+    ASSERT_EQ(copy.reduce(0, 500), total);
+}
+
+TEST(Augment, KeepsOrder) {
+    AggregateBinaryMap<int, std::string> map;
+    for (int key: {5, 2, 8, 1, 9, 3, 7, 4, 6}) {
+        map.insert({key, std::string(1, 'a' + key)});
+    }
+    ASSERT_EQ(map.reduce(2, 8), "cdefgh");
+    ASSERT_EQ(map.reduce(0, 100), "bcdefghij");
+    ASSERT_FALSE(map.reduce(10, 20).has_value());
+    map.erase(5);
+    ASSERT_EQ(map.reduce(2, 8), "cdegh");
+}
@@ -0,0 +1,273 @@
+#include "../lib/adapters.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <map>
+#include <random>
+#include <ranges>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Every adapter and the Conveyor combinations from the tests, walked by a
+// range-for over std::vector, std::list and std::map at several sizes,
+// next to the same std::views pipeline and a hand-written loop. The cost
+// is per element of the source container, so Take and Drop are cheaper
+// than a full walk. Usage: ranges_bench [--max-size N], numbers are only
+// meaningful with -DCMAKE_BUILD_TYPE=Release.
+
+volatile long long sink;
+
+// small sizes are repeated up to this many elements per measurement
+const size_t kWork = 10'000'000;
+
+template <typename Func>
+double measure(size_t size, Func func) {
+    const int kRepeats = 3;
+    size_t rounds = std::max<size_t>(kWork / std::max<size_t>(size, 1), 1);
+    double best = 0;
+    for (int i = 0; i < kRepeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        long long sum = 0;
+        for (size_t round = 0; round < rounds; ++round) {
+            sum += func();
+        }
+        sink = sum;
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best / (rounds * std::max<size_t>(size, 1));
+}
+
+int value_of(int x) {
+    return x;
+}
+
+int value_of(const std::pair<const int, int>& x) {
+    return x.second;
+}
+
+template <typename Range>
+long long sum_of(Range&& range) {
+    long long sum = 0;
+    for (const auto& x: range) {
+        sum += value_of(x);
+    }
+    return sum;
+}
+
+template <typename Ours, typename Views, typename Loop>
+void compare(const std::string& container, size_t size, const char* name,
+             Ours ours, Views views, Loop loop) {
+    if (ours() != views() || ours() != loop()) {
+        std::fprintf(stderr, "%s %s: results differ\n", container.c_str(), name);
+        std::exit(1);
+    }
+    std::printf("%-18s %9zu  %-22s %10.3f %10.3f %10.3f\n", container.c_str(), size, name,
+                measure(size, ours), measure(size, views), measure(size, loop));
+}
+
+// cases that only need value_of, so they run over every container
+template <typename Container>
+void run_common(const std::string& container, const Container& data) {
+    auto predicate = [](const auto& x){return value_of(x) % 2 == 0;};
+    auto trans = [](const auto& x){return value_of(x) * 2 + 7;};
+    size_t size = data.size();
+    size_t half = size / 2;
+
+    compare(container, size, "Filter",
+            [&]{return sum_of(data | Filter(predicate));},
+            [&]{return sum_of(data | std::views::filter(predicate));},
+            [&]{
+                long long sum = 0;
+                for (const auto& x: data) {
+                    if (predicate(x)) {
+                        sum += value_of(x);
+                    }
+                }
+                return sum;
+            });
+    compare(container, size, "Transform",
+            [&]{return sum_of(data | Transform(trans));},
+            [&]{return sum_of(data | std::views::transform(trans));},
+            [&]{
+                long long sum = 0;
+                for (const auto& x: data) {
+                    sum += trans(x);
+                }
+                return sum;
+            });
+    compare(container, size, "Take",
+            [&]{return sum_of(data | Take(half));},
+            [&]{return sum_of(data | std::views::take(half));},
+            [&]{
+                long long sum = 0;
+                auto it = data.begin();
+                for (size_t i = 0; i < half; ++i, ++it) {
+                    sum += value_of(*it);
+                }
+                return sum;
+            });
+    compare(container, size, "Drop",
+            [&]{return sum_of(data | Drop(half));},
+            [&]{return sum_of(data | std::views::drop(half));},
+            [&]{
+                long long sum = 0;
+                for (auto it = std::next(data.begin(), half); it != data.end(); ++it) {
+                    sum += value_of(*it);
+                }
+                return sum;
+            });
+    compare(container, size, "Reverse",
+            [&]{return sum_of(data | Reverse());},
+            [&]{return sum_of(data | std::views::reverse);},
+            [&]{
+                long long sum = 0;
+                for (auto it = data.rbegin(); it != data.rend(); ++it) {
+                    sum += value_of(*it);
+                }
+                return sum;
+            });
+    compare(container, size, "Drop | Filter",
+            [&]{return sum_of(data | Drop(half) | Filter(predicate));},
+            [&]{return sum_of(data | std::views::drop(half) | std::views::filter(predicate));},
+            [&]{
+                long long sum = 0;
+                for (auto it = std::next(data.begin(), half); it != data.end(); ++it) {
+                    if (predicate(*it)) {
+                        sum += value_of(*it);
+                    }
+                }
+                return sum;
+            });
+    compare(container, size, "Filter | Drop",
+            [&]{return sum_of(data | Filter(predicate) | Drop(half / 2));},
+            [&]{return sum_of(data | std::views::filter(predicate) | std::views::drop(half / 2));},
+            [&]{
+                long long sum = 0;
+                size_t skipped = 0;
+                for (const auto& x: data) {
+                    if (predicate(x) && skipped++ >= half / 2) {
+                        sum += value_of(x);
+                    }
+                }
+                return sum;
+            });
+    compare(container, size, "Reverse | Transform",
+            [&]{return sum_of(data | Reverse() | Transform(trans));},
+            [&]{return sum_of(data | std::views::reverse | std::views::transform(trans));},
+            [&]{
+                long long sum = 0;
+                for (auto it = data.rbegin(); it != data.rend(); ++it) {
+                    sum += trans(*it);
+                }
+                return sum;
+            });
+    compare(container, size, "Transform | Reverse",
+            [&]{return sum_of(data | Transform(trans) | Reverse());},
+            [&]{return sum_of(data | std::views::transform(trans) | std::views::reverse);},
+            [&]{
+                long long sum = 0;
+                for (auto it = data.rbegin(); it != data.rend(); ++it) {
+                    sum += trans(*it);
+                }
+                return sum;
+            });
+}
+
+void run_map(const std::string& container, const std::map<int, int>& data) {
+    auto trans = [](int x){return x * 2 + 7;};
+    auto pair_trans = [](const std::pair<const int, int>& x) {
+        return std::pair<const int, int>(x.first * 2 + 7, x.second * 3 + 2);
+    };
+    size_t size = data.size();
+    size_t half = size / 2;
+
+    compare(container, size, "Values",
+            [&]{return sum_of(data | Values());},
+            [&]{return sum_of(data | std::views::values);},
+            [&]{
+                long long sum = 0;
+                for (const auto& [key, value]: data) {
+                    sum += value;
+                }
+                return sum;
+            });
+    compare(container, size, "Keys",
+            [&]{return sum_of(data | Keys());},
+            [&]{return sum_of(data | std::views::keys);},
+            [&]{
+                long long sum = 0;
+                for (const auto& [key, value]: data) {
+                    sum += key;
+                }
+                return sum;
+            });
+    compare(container, size, "Values | Transform",
+            [&]{return sum_of(data | Values() | Transform(trans));},
+            [&]{return sum_of(data | std::views::values | std::views::transform(trans));},
+            [&]{
+                long long sum = 0;
+                for (const auto& [key, value]: data) {
+                    sum += trans(value);
+                }
+                return sum;
+            });
+    compare(container, size, "Transform | Values",
+            [&]{return sum_of(data | Transform(pair_trans) | Values());},
+            [&]{return sum_of(data | std::views::transform(pair_trans) | std::views::values);},
+            [&]{
+                long long sum = 0;
+                for (const auto& x: data) {
+                    sum += pair_trans(x).second;
+                }
+                return sum;
+            });
+    compare(container, size, "Values | Take",
+            [&]{return sum_of(data | Values() | Take(half));},
+            [&]{return sum_of(data | std::views::values | std::views::take(half));},
+            [&]{
+                long long sum = 0;
+                auto it = data.begin();
+                for (size_t i = 0; i < half; ++i, ++it) {
+                    sum += it->second;
+                }
+                return sum;
+            });
+}
+
+int main(int argc, char** argv) {
+    size_t max_size = 1'000'000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--max-size") == 0) {
+            max_size = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    std::printf("%-18s %9s  %-22s %10s %10s %10s   (ns/element)\n",
+                "container", "size", "pipeline", "adapters", "std::views", "loop");
+    for (size_t size = 1000; size <= max_size; size *= 10) {
+        std::vector<int> data(size);
+        std::mt19937 gen(size);
+        for (auto& x: data) {
+            x = gen() % 1000;
+        }
+        run_common("std::vector<int>", data);
+        run_common("std::list<int>", std::list<int>(data.begin(), data.end()));
+        std::map<int, int> map;
+        for (size_t i = 0; i < size; ++i) {
+            map.emplace(i * 2, data[i]);
+        }
+        run_common("std::map<int, int>", map);
+        run_map("std::map<int, int>", map);
+    }
+
+    return 0;
+}
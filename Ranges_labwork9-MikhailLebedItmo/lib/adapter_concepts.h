@@ -1,5 +1,24 @@
 #pragma once
 #include <iterator>
+#include <ranges>
+#include <type_traits>
+
+// ranges that may be walked only once, like a Generator or an Async stage,
+// only the stages that never go back over an element accept them
+template <typename T>
+concept InputView = requires(T x) {
+    x.begin();
+    x.end();
+    {x.begin()} -> std::input_iterator;
+    {x.end()} -> std::input_iterator;
+    {x.begin() != x.end()} -> std::convertible_to<bool>;
+};
+
+// the iterator category of a stage over It that keeps the forward
+// guarantee only when It has it
+template <typename It>
+using ForwardOrInputTag = std::conditional_t<std::forward_iterator<It>,
+                                             std::forward_iterator_tag, std::input_iterator_tag>;
 
 template <typename T>
 concept View = requires(T x) {
@@ -16,6 +35,26 @@ concept BidirectionalView = View<T> && requires(T x) {
     {x.end()} -> std::bidirectional_iterator;
 };
 
+// views that know their length without walking it
+template <typename T>
+concept SizedView = View<T> && requires(T x) {
+    {x.size()} -> std::convertible_to<size_t>;
+};
+
+template <typename T>
+concept RandomAccessView = BidirectionalView<T> && requires(T x) {
+    {x.begin()} -> std::random_access_iterator;
+    {x.end()} -> std::random_access_iterator;
+};
+
+// ranges of ranges whose inner ranges outlive the iterators that walk them
+template <typename T>
+concept JoinableView = View<T> && requires(T x) {
+    {(*x.begin()).begin()} -> std::forward_iterator;
+    {(*x.begin()).end()} -> std::forward_iterator;
+} && (std::is_lvalue_reference_v<std::iter_reference_t<decltype(std::declval<T>().begin())>> ||
+      std::ranges::borrowed_range<std::iter_reference_t<decltype(std::declval<T>().begin())>>);
+
 template <typename V, size_t N>
 concept TupleLikeView = View<V> && requires(V v) {
     std::get<N>(*v.begin());
@@ -5,6 +5,18 @@
 #include "reverse_adapter.h"
 #include "values_adapter.h"
 #include "transform_adapter.h"
+#include "cache_adapter.h"
+#include "chunk_adapter.h"
+#include "batch_adapter.h"
+#include "zip_adapter.h"
+#include "enumerate_adapter.h"
+#include "join_adapter.h"
+#include "generator.h"
+#include "async_adapter.h"
+#include "parallel_adapter.h"
+#include "terminal_adapter.h"
+#include "pipeline.h"
 
 
 using Keys = Values<0>;
+using Flatten = Join;
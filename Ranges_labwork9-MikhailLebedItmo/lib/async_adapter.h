@@ -0,0 +1,274 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Bounded single producer single consumer queue between the thread that runs
+// the upstream part of an Async pipeline and the one that walks it. Each
+// side publishes only its own counter, a set kClosed bit in a counter means
+// that side is finished: the producer ran out of elements (or threw), or
+// the consumer stopped early. A side blocks with atomic wait only when the
+// queue is full or empty. The producer wakes a blocked consumer right after
+// the push that ends the empty queue, so a slow upstream hands over every
+// element as soon as it is made. The consumer wakes a blocked producer once
+// per half a queue of pops, so the threads do not take turns per element.
+// Both sides also look for a blocked peer (the only fenced step) once per
+// half a queue and before blocking themselves, which covers a peer that
+// went to sleep while its flag was not visible yet. The counters are 32 bit
+// to be futex words and wrap at kClosed, so the capacity is rounded up to a
+// power of two.
+template <typename T>
+class AsyncQueue {
+public:
+    static constexpr uint32_t kClosed = uint32_t(1) << 31;
+
+    explicit AsyncQueue(size_t depth)
+      : slots(std::bit_ceil(std::max<size_t>(depth, 1))), head(0), tail(0),
+        producer_waiting(false), consumer_waiting(false) {}
+
+    // false when the consumer is gone
+    template <typename U>
+    bool push(U&& value) {
+        if (size(producer.own, producer.other) == slots.size()) {
+            producer.other = head.load(std::memory_order_acquire);
+            while (!(producer.other & kClosed) && size(producer.own, producer.other) == slots.size()) {
+                wake(consumer_waiting, tail);
+                producer_waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                producer.other = head.load(std::memory_order_acquire);
+                if (!(producer.other & kClosed) && size(producer.own, producer.other) == slots.size()) {
+                    head.wait(producer.other, std::memory_order_acquire);
+                }
+                producer_waiting.store(false, std::memory_order_relaxed);
+                producer.other = head.load(std::memory_order_acquire);
+            }
+        }
+        if (producer.other & kClosed) {
+            return false;
+        }
+        slots[producer.own & (slots.size() - 1)].emplace(std::forward<U>(value));
+        producer.own = (producer.own + 1) & ~kClosed;
+        tail.store(producer.own, std::memory_order_release);
+        // the consumer only blocks on an empty queue, so a raised flag means
+        // this push made it non-empty
+        if (consumer_waiting.load(std::memory_order_relaxed)) {
+            producer.unchecked = 0;
+            wake(consumer_waiting, tail);
+        } else if (++producer.unchecked == half()) {
+            producer.unchecked = 0;
+            wake(consumer_waiting, tail);
+        }
+        return true;
+    }
+
+    void close_producer(std::exception_ptr failure) {
+        error = failure;
+        tail.fetch_or(kClosed);
+        tail.notify_one();
+    }
+
+    void close_consumer() {
+        head.fetch_or(kClosed);
+        head.notify_one();
+    }
+
+    // the oldest element, nullptr once the producer is done and the queue
+    // is empty, rethrows what the producer threw
+    const T* front() {
+        if (consumer.own == (consumer.other & ~kClosed)) {
+            consumer.other = tail.load(std::memory_order_acquire);
+            while (consumer.own == (consumer.other & ~kClosed)) {
+                if (consumer.other & kClosed) {
+                    if (error) {
+                        std::rethrow_exception(std::exchange(error, nullptr));
+                    }
+                    return nullptr;
+                }
+                wake(producer_waiting, head);
+                consumer_waiting.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                consumer.other = tail.load(std::memory_order_acquire);
+                if (consumer.other == consumer.own) {
+                    tail.wait(consumer.other, std::memory_order_acquire);
+                }
+                consumer_waiting.store(false, std::memory_order_relaxed);
+                consumer.other = tail.load(std::memory_order_acquire);
+            }
+        }
+        return &*slots[consumer.own & (slots.size() - 1)];
+    }
+
+    void pop() {
+        slots[consumer.own & (slots.size() - 1)].reset();
+        consumer.own = (consumer.own + 1) & ~kClosed;
+        head.store(consumer.own, std::memory_order_release);
+        if (++consumer.unchecked == half()) {
+            consumer.unchecked = 0;
+            wake(producer_waiting, head);
+        }
+    }
+private:
+    // touched by one side only: its own counter, the last seen counter of
+    // the other side and the elements moved since it last looked for a
+    // blocked peer
+    struct Side {
+        uint32_t own = 0;
+        uint32_t other = 0;
+        size_t unchecked = 0;
+    };
+
+    std::vector<std::optional<T>> slots;
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    alignas(64) std::atomic<bool> producer_waiting;
+    std::atomic<bool> consumer_waiting;
+    alignas(64) Side producer;
+    alignas(64) Side consumer;
+    std::exception_ptr error;
+
+    static size_t size(uint32_t pushed, uint32_t popped) {
+        return ((pushed & ~kClosed) - (popped & ~kClosed)) & ~kClosed;
+    }
+
+    size_t half() const {
+        return (slots.size() + 1) / 2;
+    }
+
+    // pairs with the fence of the waiting side: either it sees the new
+    // counter or this sees its flag
+    static void wake(std::atomic<bool>& waiting, std::atomic<uint32_t>& counter) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) && waiting.exchange(false)) {
+            counter.notify_one();
+        }
+    }
+};
+
+// One run of an Async stage: the producer thread pushes the upstream range
+// into the queue and the state joins it when the last iterator goes away,
+// stopping it first if the consumer did not read everything.
+template <std::input_iterator It>
+class AsyncState {
+public:
+    using value_type = std::iter_value_t<It>;
+
+    AsyncState(It beg, It last, size_t depth): queue(depth) {
+        producer = std::thread([this, beg, last] {
+            auto sink = [this](auto&& value) {
+                return queue.push(std::forward<decltype(value)>(value));
+            };
+            try {
+                push_range(beg, last, sink);
+                queue.close_producer(nullptr);
+            } catch (...) {
+                queue.close_producer(std::current_exception());
+            }
+        });
+    }
+
+    AsyncState(const AsyncState&) = delete;
+    AsyncState& operator=(const AsyncState&) = delete;
+
+    ~AsyncState() {
+        queue.close_consumer();
+        producer.join();
+    }
+
+    AsyncQueue<value_type>& get_queue() {
+        return queue;
+    }
+private:
+    AsyncQueue<value_type> queue;
+    std::thread producer;
+};
+
+// Walks the queue, copies share it, so the range is walked once and the
+// iterator is an input iterator only, like GeneratorIterator.
+template <std::input_iterator It>
+class AsyncIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    AsyncIterator(): state(), cur(nullptr) {}
+
+    explicit AsyncIterator(std::shared_ptr<AsyncState<It>> state)
+      : state(std::move(state)), cur(this->state->get_queue().front()) {}
+
+    AsyncIterator& operator++() {
+        auto& queue = state->get_queue();
+        queue.pop();
+        cur = queue.front();
+        return *this;
+    }
+
+    void operator++(int) {
+        ++(*this);
+    }
+
+    reference operator*() const {
+        return *cur;
+    }
+
+    friend bool operator==(const AsyncIterator& left, const AsyncIterator& right) {
+        return (left.cur == nullptr) == (right.cur == nullptr);
+    }
+
+    friend bool operator!=(const AsyncIterator& left, const AsyncIterator& right) {
+        return !(left == right);
+    }
+private:
+    std::shared_ptr<AsyncState<It>> state;
+    const value_type* cur;
+};
+
+// Every begin() starts the upstream range on its own thread, the elements
+// are copied into a queue of queue_depth elements, so a slow upstream
+// (I/O, a Generator) overlaps with the stages after Async.
+template <std::input_iterator It>
+class AsyncView {
+public:
+    AsyncView(It beg, It last, size_t depth): beg(beg), last(last), depth(depth) {}
+
+    AsyncIterator<It> begin() {
+        return AsyncIterator<It>(std::make_shared<AsyncState<It>>(beg, last, depth));
+    }
+
+    AsyncIterator<It> end() {
+        return AsyncIterator<It>();
+    }
+private:
+    It beg;
+    It last;
+    size_t depth;
+};
+
+// the queue holds queue_depth elements rounded up to a power of two
+class Async {
+public:
+    const size_t queue_depth;
+    explicit Async(size_t queue_depth): queue_depth(queue_depth) {}
+};
+
+template <InputView V>
+auto operator|(V&& left, Async async) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return AsyncView(beg, last, async.queue_depth);
+}
@@ -0,0 +1,272 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <concepts>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Batch(n) copies the elements of any pipeline into a buffer of n elements
+// and hands out the filled buffer as a std::span. The buffer is allocated
+// once per iterator and refilled in place, Chunk does the same without a
+// copy when the source itself is contiguous.
+template <std::forward_iterator It>
+class BatchForwardIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::span<const std::iter_value_t<It>>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = value_type;
+
+    BatchForwardIterator(): cur(), next(), last(), n(), buffer() {}
+
+    BatchForwardIterator(It beg, It last, size_t n): cur(beg), next(beg), last(last), n(n), buffer() {
+        if (cur != last) {
+            buffer.reserve(n);
+            fill();
+        }
+    }
+
+    BatchForwardIterator& operator++() {
+        cur = next;
+        fill();
+        return *this;
+    }
+
+    BatchForwardIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return value_type(buffer);
+    }
+
+    friend bool operator==(const BatchForwardIterator& left, const BatchForwardIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const BatchForwardIterator& left, const BatchForwardIterator& right) {
+        return left.cur != right.cur;
+    }
+
+    // the rest of the source is pushed into the buffer of first
+    template <typename Sink>
+    friend bool push_range(BatchForwardIterator first, BatchForwardIterator last, Sink& sink) {
+        if (first == last) {
+            return true;
+        }
+        if (!sink(*first)) {
+            return false;
+        }
+        auto& buffer = first.buffer;
+        buffer.clear();
+        auto batched = [&buffer, &first, &sink](auto&& value) {
+            buffer.push_back(std::forward<decltype(value)>(value));
+            if (buffer.size() < first.n) {
+                return true;
+            }
+            bool more = sink(value_type(buffer));
+            buffer.clear();
+            return more;
+        };
+        return push_range(first.next, last.cur, batched) && (buffer.empty() || sink(value_type(buffer)));
+    }
+private:
+    It cur;
+    It next;
+    It last;
+    size_t n;
+    std::vector<std::iter_value_t<It>> buffer;
+
+    void fill() {
+        buffer.clear();
+        for (; next != last && buffer.size() < n; ++next) {
+            buffer.push_back(*next);
+        }
+    }
+};
+
+template <std::forward_iterator It>
+class BatchView {
+public:
+    BatchView(It beg, It last, size_t n): beg(beg), last(last), n(n) {}
+
+    BatchForwardIterator<It> begin() {
+        return BatchForwardIterator<It>(beg, last, n);
+    }
+
+    BatchForwardIterator<It> end() {
+        return BatchForwardIterator<It>(last, last, n);
+    }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return (static_cast<size_t>(last - beg) + n - 1) / n;
+    }
+private:
+    It beg;
+    It last;
+    size_t n;
+};
+
+// n has to be positive
+class Batch {
+public:
+    const size_t n;
+    explicit Batch(size_t n): n(n) {}
+};
+
+template <View V>
+auto operator|(V&& left, Batch batch) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return BatchView(beg, last, batch.n);
+}
+
+template <typename Func, typename It>
+concept BatchKernel = std::invocable<Func&, std::span<std::iter_value_t<It>>>;
+
+// TransformBatch(f) collects blocks of the pipeline like Batch and calls
+// f(std::span<T>) once per block to change the elements in place, so f can
+// be a vectorized kernel, the elements then go on one by one.
+template <std::forward_iterator It, BatchKernel<It> Func>
+class TransformBatchForwardIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    TransformBatchForwardIterator(): cur(), next(), last(), n(), index(), buffer(), kernel() {}
+
+    TransformBatchForwardIterator(It beg, It last, size_t n, Func kernel)
+      : cur(beg), next(beg), last(last), n(n), index(0), buffer(), kernel(kernel) {
+        if (cur != last) {
+            buffer.reserve(n);
+            fill();
+        }
+    }
+
+    TransformBatchForwardIterator& operator++() {
+        if (++index == buffer.size()) {
+            cur = next;
+            fill();
+        }
+        return *this;
+    }
+
+    TransformBatchForwardIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return buffer[index];
+    }
+
+    friend bool operator==(const TransformBatchForwardIterator& left, const TransformBatchForwardIterator& right) {
+        return left.cur == right.cur && left.index == right.index;
+    }
+
+    friend bool operator!=(const TransformBatchForwardIterator& left, const TransformBatchForwardIterator& right) {
+        return !(left == right);
+    }
+
+    template <typename Sink>
+    friend bool push_range(TransformBatchForwardIterator first, TransformBatchForwardIterator last, Sink& sink) {
+        if (first == last) {
+            return true;
+        }
+        auto& buffer = first.buffer;
+        if (!push_loop(buffer.cbegin() + first.index, buffer.cend(), sink)) {
+            return false;
+        }
+        buffer.clear();
+        auto flush = [&buffer, &first, &sink] {
+            first.kernel(std::span<value_type>(buffer));
+            bool more = push_loop(buffer.cbegin(), buffer.cend(), sink);
+            buffer.clear();
+            return more;
+        };
+        auto batched = [&buffer, &first, &flush](auto&& value) {
+            buffer.push_back(std::forward<decltype(value)>(value));
+            return buffer.size() < first.n || flush();
+        };
+        return push_range(first.next, last.cur, batched) && (buffer.empty() || flush());
+    }
+private:
+    It cur;
+    It next;
+    It last;
+    size_t n;
+    size_t index;
+    std::vector<value_type> buffer;
+    [[no_unique_address]] Func kernel;
+
+    void fill() {
+        buffer.clear();
+        index = 0;
+        for (; next != last && buffer.size() < n; ++next) {
+            buffer.push_back(*next);
+        }
+        if (!buffer.empty()) {
+            kernel(std::span<value_type>(buffer));
+        }
+    }
+};
+
+template <std::forward_iterator It, BatchKernel<It> Func>
+class TransformBatchView {
+public:
+    TransformBatchView(It beg, It last, size_t n, Func kernel): beg(beg), last(last), n(n), kernel(kernel) {}
+
+    TransformBatchForwardIterator<It, Func> begin() {
+        return TransformBatchForwardIterator<It, Func>(beg, last, n, kernel);
+    }
+
+    TransformBatchForwardIterator<It, Func> end() {
+        return TransformBatchForwardIterator<It, Func>(last, last, n, kernel);
+    }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return last - beg;
+    }
+private:
+    It beg;
+    It last;
+    size_t n;
+    [[no_unique_address]] Func kernel;
+};
+
+const size_t kDefaultBatchSize = 256;
+
+template <typename Func>
+class TransformBatch {
+public:
+    explicit TransformBatch(Func kernel, size_t n = kDefaultBatchSize): kernel(kernel), n(n) {}
+
+    Func get_kernel() const {
+        return kernel;
+    }
+
+    size_t get_size() const {
+        return n;
+    }
+private:
+    [[no_unique_address]] Func kernel;
+    size_t n;
+};
+
+template <View V, BatchKernel<decltype(std::declval<V>().begin())> Func>
+auto operator|(V&& left, TransformBatch<Func> transform) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return TransformBatchView(beg, last, transform.get_size(), transform.get_kernel());
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <iterator>
+#include <optional>
+#include <utility>
+
+// Cache1 keeps the last dereferenced element in the iterator, so stages
+// that look at an element more than once (Filter checks it and then hands
+// it out) evaluate a Transform before it once per position. Elements are
+// returned by value, references into the iterator would dangle in Reverse.
+template <std::forward_iterator It>
+class CacheForwardIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = value_type;
+
+    CacheForwardIterator(): cur(), cache() {}
+
+    explicit CacheForwardIterator(It it): cur(it), cache() {}
+
+    CacheForwardIterator& operator++() {
+        ++cur;
+        cache.reset();
+        return *this;
+    }
+
+    CacheForwardIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        if (!cache) {
+            cache.emplace(*cur);
+        }
+        return *cache;
+    }
+
+    friend bool operator==(const CacheForwardIterator& left, const CacheForwardIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const CacheForwardIterator& left, const CacheForwardIterator& right) {
+        return left.cur != right.cur;
+    }
+
+    // every element is pushed once anyway
+    template <typename Sink>
+    friend bool push_range(CacheForwardIterator first, CacheForwardIterator last, Sink& sink) {
+        return push_range(first.cur, last.cur, sink);
+    }
+
+    friend auto parallel_source(const CacheForwardIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<CacheForwardIterator, CacheForwardIterator> rebase(CacheForwardIterator first, CacheForwardIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {CacheForwardIterator(cur), CacheForwardIterator(end)};
+    }
+private:
+    It cur;
+    mutable std::optional<value_type> cache;
+};
+
+template <std::bidirectional_iterator It>
+class CacheBidirectionalIterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = value_type;
+
+    CacheBidirectionalIterator(): cur(), cache() {}
+
+    explicit CacheBidirectionalIterator(It it): cur(it), cache() {}
+
+    CacheBidirectionalIterator& operator++() {
+        ++cur;
+        cache.reset();
+        return *this;
+    }
+
+    CacheBidirectionalIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    CacheBidirectionalIterator& operator--() {
+        --cur;
+        cache.reset();
+        return *this;
+    }
+
+    CacheBidirectionalIterator operator--(int) {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        if (!cache) {
+            cache.emplace(*cur);
+        }
+        return *cache;
+    }
+
+    friend bool operator==(const CacheBidirectionalIterator& left, const CacheBidirectionalIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const CacheBidirectionalIterator& left, const CacheBidirectionalIterator& right) {
+        return left.cur != right.cur;
+    }
+
+    template <typename Sink>
+    friend bool push_range(CacheBidirectionalIterator first, CacheBidirectionalIterator last, Sink& sink) {
+        return push_range(first.cur, last.cur, sink);
+    }
+
+    friend auto parallel_source(const CacheBidirectionalIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<CacheBidirectionalIterator, CacheBidirectionalIterator> rebase(CacheBidirectionalIterator first, CacheBidirectionalIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {CacheBidirectionalIterator(cur), CacheBidirectionalIterator(end)};
+    }
+private:
+    It cur;
+    mutable std::optional<value_type> cache;
+};
+
+template <std::forward_iterator It>
+class CacheView {
+public:
+    CacheView(It beg, It last): beg(beg), last(last) {}
+
+    auto begin() {
+        if constexpr (std::bidirectional_iterator<It>) {
+            return CacheBidirectionalIterator<It>(beg);
+        } else {
+            return CacheForwardIterator<It>(beg);
+        }
+    }
+
+    auto end() {
+        if constexpr (std::bidirectional_iterator<It>) {
+            return CacheBidirectionalIterator<It>(last);
+        } else {
+            return CacheForwardIterator<It>(last);
+        }
+    }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return last - beg;
+    }
+private:
+    It beg;
+    It last;
+};
+
+class Cache1 {};
+
+template <View V>
+auto operator|(V&& left, Cache1) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return CacheView(beg, last);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+// Splits the source into consecutive blocks of n elements (the last one may
+// be shorter) without copying them: a block of a contiguous source is a
+// std::span that kernels can vectorize over, otherwise a subrange.
+template <std::forward_iterator It>
+class ChunkForwardIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::conditional_t<std::contiguous_iterator<It>,
+                                          std::span<std::remove_reference_t<std::iter_reference_t<It>>>,
+                                          std::ranges::subrange<It>>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = value_type;
+
+    ChunkForwardIterator(): cur(), next(), last(), n() {}
+
+    ChunkForwardIterator(It beg, It last, size_t n): cur(beg), next(beg), last(last), n(n) {
+        my_advance(next, n, last);
+    }
+
+    ChunkForwardIterator& operator++() {
+        cur = next;
+        my_advance(next, n, last);
+        return *this;
+    }
+
+    ChunkForwardIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        if constexpr (std::contiguous_iterator<It>) {
+            return value_type(std::to_address(cur), next - cur);
+        } else {
+            return value_type(cur, next);
+        }
+    }
+
+    friend bool operator==(const ChunkForwardIterator& left, const ChunkForwardIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const ChunkForwardIterator& left, const ChunkForwardIterator& right) {
+        return left.cur != right.cur;
+    }
+private:
+    It cur;
+    It next;
+    It last;
+    size_t n;
+};
+
+template <std::forward_iterator It>
+class ChunkView {
+public:
+    ChunkView(It beg, It last, size_t n): beg(beg), last(last), n(n) {}
+
+    ChunkForwardIterator<It> begin() {
+        return ChunkForwardIterator<It>(beg, last, n);
+    }
+
+    ChunkForwardIterator<It> end() {
+        return ChunkForwardIterator<It>(last, last, n);
+    }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return (static_cast<size_t>(last - beg) + n - 1) / n;
+    }
+private:
+    It beg;
+    It last;
+    size_t n;
+};
+
+// n has to be positive
+class Chunk {
+public:
+    const size_t n;
+    explicit Chunk(size_t n): n(n) {}
+};
+
+template <View V>
+auto operator|(V&& left, Chunk chunk) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return ChunkView(beg, last, chunk.n);
+}
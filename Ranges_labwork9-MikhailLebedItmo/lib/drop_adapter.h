@@ -1,28 +1,53 @@
 #pragma once
 #include "utils.h"
+#include "owning_iterator.h"
 #include "adapter_concepts.h"
 
+#include <algorithm>
 #include <iterator>
+#include <limits>
+#include <utility>
 
 
+class Drop;
+
 template <std::input_iterator It>
 class DropView{
 public:
     using reference = std::iter_reference_t<It>;
     using value_type = std::iter_value_t<It>;
 
-    DropView(It beg, It last): beg(beg), last(last) {}
+    DropView(It beg, It last, size_t shift): beg(beg), last(last), shift(shift) {}
 
+    // the skipped prefix is walked by the first call only
     It begin() {
+        if (shift != 0) {
+            using Difference = std::iter_difference_t<It>;
+            auto max_shift = static_cast<size_t>(std::numeric_limits<Difference>::max());
+            my_advance(beg, static_cast<Difference>(std::min(shift, max_shift)), last);
+            shift = 0;
+        }
         return beg;
     }
 
     It end() {
         return last;
     }
+
+    size_t size() requires std::sized_sentinel_for<It, It> {
+        return end() - begin();
+    }
+
+    auto data() requires std::contiguous_iterator<It> {
+        return std::to_address(begin());
+    }
+
+    template <std::input_iterator I>
+    friend auto operator|(DropView<I> left, Drop right);
 private:
     It beg;
     It last;
+    size_t shift;
 };
 
 class Drop {
@@ -31,9 +56,24 @@ public:
     explicit Drop(size_t shift): shift(shift) {}
 };
 
-template <View V>
+template <InputView V>
 auto operator|(V&& left, Drop right) {
-    auto new_begin = left.begin();
-    my_advance(new_begin, right.shift, left.end());
-    return DropView(new_begin, left.end());
-}
\ No newline at end of file
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return DropView(beg, last, right.shift);
+}
+
+// shifts saturate, dropping more than SIZE_MAX elements drops them all anyway
+inline size_t add_shifts(size_t left, size_t right) {
+    return left > std::numeric_limits<size_t>::max() - right ? std::numeric_limits<size_t>::max() : left + right;
+}
+
+// the shift is still pending or already applied to beg, either way
+// the rest is dropped from beg
+template <std::input_iterator It>
+auto operator|(DropView<It> left, Drop right) {
+    return DropView<It>(left.beg, left.last, add_shifts(left.shift, right.shift));
+}
+
+inline Drop fuse(Drop left, Drop right) {
+    return Drop(add_shifts(left.shift, right.shift));
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+// Pairs every element with its position, (index, element reference), so
+// Keys gives the indices and Values the elements. Keeps the category of
+// the source up to random access. Over a bidirectional source the end
+// does not know its index until it is decremented, then it counts from the
+// first element once, so building and walking the view stays lazy.
+template <std::forward_iterator It>
+class EnumerateIterator {
+public:
+    static constexpr size_t kUnplaced = size_t(-1);
+
+    using iterator_category = std::conditional_t<std::random_access_iterator<It>, std::random_access_iterator_tag,
+                              std::conditional_t<std::bidirectional_iterator<It>, std::bidirectional_iterator_tag,
+                                                 std::forward_iterator_tag>>;
+    using value_type = std::pair<size_t, std::iter_value_t<It>>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = std::pair<size_t, std::iter_reference_t<It>>;
+
+    EnumerateIterator(): cur(), first(), index() {}
+
+    EnumerateIterator(It it, It first, size_t index): cur(it), first(first), index(index) {}
+
+    EnumerateIterator& operator++() {
+        ++cur;
+        ++index;
+        return *this;
+    }
+
+    EnumerateIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    EnumerateIterator& operator--() requires std::bidirectional_iterator<It> {
+        if (index == kUnplaced) {
+            index = std::distance(first, cur);
+        }
+        --cur;
+        --index;
+        return *this;
+    }
+
+    EnumerateIterator operator--(int) requires std::bidirectional_iterator<It> {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return reference(index, *cur);
+    }
+
+    EnumerateIterator& operator+=(difference_type n) requires std::random_access_iterator<It> {
+        cur += n;
+        index += n;
+        return *this;
+    }
+
+    EnumerateIterator& operator-=(difference_type n) requires std::random_access_iterator<It> {
+        cur -= n;
+        index -= n;
+        return *this;
+    }
+
+    reference operator[](difference_type n) const requires std::random_access_iterator<It> {
+        return reference(index + n, cur[n]);
+    }
+
+    friend bool operator==(const EnumerateIterator& left, const EnumerateIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend auto operator<=>(const EnumerateIterator& left, const EnumerateIterator& right)
+            requires std::random_access_iterator<It> {
+        return left.cur <=> right.cur;
+    }
+
+    friend EnumerateIterator operator+(const EnumerateIterator& left, difference_type n)
+            requires std::random_access_iterator<It> {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend EnumerateIterator operator+(difference_type n, const EnumerateIterator& left)
+            requires std::random_access_iterator<It> {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend EnumerateIterator operator-(const EnumerateIterator& left, difference_type n)
+            requires std::random_access_iterator<It> {
+        auto copy = left;
+        copy -= n;
+        return copy;
+    }
+
+    friend difference_type operator-(const EnumerateIterator& left, const EnumerateIterator& right)
+            requires std::random_access_iterator<It> {
+        return left.cur - right.cur;
+    }
+
+    template <typename Sink>
+    friend bool push_range(EnumerateIterator first, EnumerateIterator last, Sink& sink) {
+        auto counted = [&first, &sink](auto&& value) {
+            return sink(reference(first.index++, std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, counted);
+    }
+private:
+    It cur;
+    It first;
+    size_t index;
+};
+
+template <std::forward_iterator It>
+class EnumerateView {
+public:
+    EnumerateView(It beg, It last): beg(beg), last(last) {}
+
+    EnumerateIterator<It> begin() {
+        return EnumerateIterator<It>(beg, beg, 0);
+    }
+
+    // the index of the end matters only when walking back from it
+    EnumerateIterator<It> end() {
+        if constexpr (std::random_access_iterator<It>) {
+            return EnumerateIterator<It>(last, beg, last - beg);
+        } else {
+            return EnumerateIterator<It>(last, beg, EnumerateIterator<It>::kUnplaced);
+        }
+    }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return last - beg;
+    }
+private:
+    It beg;
+    It last;
+};
+
+class Enumerate {};
+
+template <View V>
+auto operator|(V&& left, Enumerate) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return EnumerateView(beg, last);
+}
@@ -1,12 +1,29 @@
 #pragma once
 #include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
 
 #include <concepts>
 #include <iterator>
+#include <utility>
 
+template <typename Func>
+class Filter;
+
+// both predicates hold, the second one is not asked when the first fails
+template <typename First, typename Second>
+struct Conjunction {
+    [[no_unique_address]] First first;
+    [[no_unique_address]] Second second;
+
+    template <typename T>
+    bool operator()(T&& value) const {
+        return first(value) && second(std::forward<T>(value));
+    }
+};
 
-template <std::forward_iterator It, std::indirect_unary_predicate<It> Func>
-class FilterForwardIterator: public std::iterator<std::forward_iterator_tag,
+template <std::input_iterator It, std::indirect_unary_predicate<It> Func>
+class FilterForwardIterator: public std::iterator<ForwardOrInputTag<It>,
                                             std::iter_value_t<It>,
                                             std::iter_difference_t<It>,
                                             std::add_pointer_t<std::iter_value_t<It>>,
@@ -42,6 +59,35 @@ public:
     friend bool operator!=(const FilterForwardIterator& left, const FilterForwardIterator& right) {
         return !(left == right);
     }
+
+    template <typename Sink>
+    friend bool push_range(FilterForwardIterator first, FilterForwardIterator last, Sink& sink) {
+        // first already stands on a match, only the rest is tested
+        if (first.cur == last.cur) {
+            return true;
+        }
+        if (!sink(*first.cur)) {
+            return false;
+        }
+        ++first.cur;
+        auto filtered = [&first, &sink](auto&& value) {
+            return !first.predicate(value) || sink(std::forward<decltype(value)>(value));
+        };
+        return push_range(first.cur, last.cur, filtered);
+    }
+
+    friend auto parallel_source(const FilterForwardIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<FilterForwardIterator, FilterForwardIterator> rebase(FilterForwardIterator first, FilterForwardIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        while (cur != end && !first.predicate(*cur)) {
+            ++cur;
+        }
+        return {FilterForwardIterator(cur, end, first.predicate), FilterForwardIterator(end, end, first.predicate)};
+    }
 private:
     It cur;
     It last;
@@ -99,23 +145,55 @@ public:
     friend bool operator!=(const FilterBidirectionalIterator& left, const FilterBidirectionalIterator& right) {
         return !(left == right);
     }
+
+    template <typename Sink>
+    friend bool push_range(FilterBidirectionalIterator first, FilterBidirectionalIterator last, Sink& sink) {
+        // first already stands on a match, only the rest is tested
+        if (first.cur == last.cur) {
+            return true;
+        }
+        if (!sink(*first.cur)) {
+            return false;
+        }
+        ++first.cur;
+        auto filtered = [&first, &sink](auto&& value) {
+            return !first.predicate(value) || sink(std::forward<decltype(value)>(value));
+        };
+        return push_range(first.cur, last.cur, filtered);
+    }
+
+    friend auto parallel_source(const FilterBidirectionalIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<FilterBidirectionalIterator, FilterBidirectionalIterator> rebase(FilterBidirectionalIterator first, FilterBidirectionalIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        while (cur != end && !first.predicate(*cur)) {
+            ++cur;
+        }
+        return {FilterBidirectionalIterator(cur, end, first.predicate), FilterBidirectionalIterator(end, end, first.predicate)};
+    }
 private:
     It cur;
     It last;
     [[no_unique_address]] Func predicate;
 };
 
-template <std::forward_iterator It, std::indirect_unary_predicate<It> Func>
+template <std::input_iterator It, std::indirect_unary_predicate<It> Func>
 class FilterView {
 public:
     FilterView(It beg, It last, Func predicate)
-      :beg(beg), last(last), predicate(predicate) {
-        while (this->beg != last && !predicate(*this->beg)) {
-            ++(this->beg);
-        }
-    }
+      :beg(beg), last(last), predicate(predicate) {}
 
+    // the first match is looked for by the first call only
     auto begin() {
+        if (!scanned) {
+            while (beg != last && !predicate(*beg)) {
+                ++beg;
+            }
+            scanned = true;
+        }
         if constexpr (std::bidirectional_iterator<It>) {
             return FilterBidirectionalIterator(beg, last, predicate);
         } else {
@@ -130,10 +208,14 @@ public:
             return FilterForwardIterator(last, last, predicate);
         }
     }
+
+    template <std::input_iterator I, typename F, typename Next>
+    friend auto operator|(FilterView<I, F> left, Filter<Next> right);
 private:
     It beg;
     It last;
     [[no_unique_address]] Func predicate;
+    bool scanned = false;
 };
 
 
@@ -149,7 +231,20 @@ private:
     [[no_unique_address]] Func predicate;
 };
 
-template <View V, std::indirect_unary_predicate<decltype(std::declval<V>().begin())> Func>
+template <InputView V, std::indirect_unary_predicate<decltype(std::declval<V>().begin())> Func>
 auto operator|(V&& left, Filter<Func> filter) {
-    return FilterView(left.begin(), left.end(), filter.get_predicate());
-}
\ No newline at end of file
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return FilterView(beg, last, filter.get_predicate());
+}
+
+// a filter of a filter is one layer over the same iterators
+template <std::input_iterator It, typename Func, typename Next>
+auto operator|(FilterView<It, Func> left, Filter<Next> right) {
+    using Fused = Conjunction<Func, Next>;
+    return FilterView<It, Fused>(left.beg, left.last, Fused{left.predicate, right.get_predicate()});
+}
+
+template <typename Func, typename Next>
+auto fuse(Filter<Func> left, Filter<Next> right) {
+    return Filter(Conjunction<Func, Next>{left.get_predicate(), right.get_predicate()});
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "adapter_concepts.h"
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class Generator;
+
+// Copies of the iterator share the coroutine, so a generator is walked once
+// and the iterator is an input iterator only. Filter, Transform, Take, Drop,
+// Async and the terminals accept it, stages that keep positions to come
+// back to (Chunk, Batch, Reverse, ...) need a container in between.
+template <typename T>
+class GeneratorIterator {
+public:
+    using handle_type = std::coroutine_handle<typename Generator<T>::promise_type>;
+
+    using iterator_category = std::input_iterator_tag;
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using distance_type = difference_type;
+    using pointer = const T*;
+    using reference = const T&;
+
+    GeneratorIterator(): coroutine() {}
+
+    explicit GeneratorIterator(handle_type coroutine): coroutine(coroutine) {}
+
+    GeneratorIterator& operator++() {
+        coroutine.resume();
+        coroutine.promise().rethrow();
+        return *this;
+    }
+
+    void operator++(int) {
+        ++(*this);
+    }
+
+    reference operator*() const {
+        return *coroutine.promise().value;
+    }
+
+    friend bool operator==(const GeneratorIterator& left, const GeneratorIterator& right) {
+        return left.at_end() == right.at_end();
+    }
+
+    friend bool operator!=(const GeneratorIterator& left, const GeneratorIterator& right) {
+        return !(left == right);
+    }
+private:
+    handle_type coroutine;
+
+    bool at_end() const {
+        return !coroutine || coroutine.done();
+    }
+};
+
+// Coroutine source for pipelines:
+//     Generator<int> naturals() { for (int i = 0;; ++i) co_yield i; }
+//     naturals() | Filter(odd) | Take(5) | To<std::vector<int>>();
+// The body runs up to the first co_yield on begin() and to the next one on
+// every ++, yielded values are read in place. Exceptions from the body come
+// out of begin() and ++.
+template <typename T>
+class Generator {
+public:
+    class promise_type {
+    public:
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        // the yielded object lives until the coroutine is resumed
+        std::suspend_always yield_value(const T& yielded) noexcept {
+            value = std::addressof(yielded);
+            return {};
+        }
+
+        std::suspend_always yield_value(T&& yielded) noexcept {
+            value = std::addressof(yielded);
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+
+        void rethrow() {
+            if (error) {
+                std::rethrow_exception(std::exchange(error, nullptr));
+            }
+        }
+    private:
+        const T* value = nullptr;
+        std::exception_ptr error;
+
+        friend class GeneratorIterator<T>;
+    };
+
+    using iterator = GeneratorIterator<T>;
+
+    Generator(Generator&& other) noexcept: coroutine(std::exchange(other.coroutine, nullptr)), started(other.started) {}
+
+    Generator& operator=(Generator&& other) noexcept {
+        std::swap(coroutine, other.coroutine);
+        std::swap(started, other.started);
+        return *this;
+    }
+
+    ~Generator() {
+        if (coroutine) {
+            coroutine.destroy();
+        }
+    }
+
+    iterator begin() {
+        if (!started) {
+            started = true;
+            coroutine.resume();
+            coroutine.promise().rethrow();
+        }
+        return iterator(coroutine);
+    }
+
+    iterator end() {
+        return iterator();
+    }
+private:
+    std::coroutine_handle<promise_type> coroutine;
+    bool started = false;
+
+    explicit Generator(std::coroutine_handle<promise_type> coroutine): coroutine(coroutine) {}
+};
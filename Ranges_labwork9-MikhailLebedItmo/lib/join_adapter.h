@@ -0,0 +1,124 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <iterator>
+#include <utility>
+
+// Flattens a range of ranges. The inner ranges are not stored, so they have
+// to outlive the iterators: elements of a container (lvalues) or borrowed
+// ranges such as the spans and subranges from Chunk.
+template <std::forward_iterator It>
+class JoinForwardIterator {
+public:
+    using inner_iterator = decltype(std::declval<std::iter_reference_t<It>>().begin());
+
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::iter_value_t<inner_iterator>;
+    using difference_type = std::iter_difference_t<inner_iterator>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = std::iter_reference_t<inner_iterator>;
+
+    JoinForwardIterator(): outer(), outer_last(), inner(), inner_last() {}
+
+    JoinForwardIterator(It outer, It outer_last): outer(outer), outer_last(outer_last), inner(), inner_last() {
+        if (this->outer != outer_last) {
+            enter();
+            skip_empty();
+        }
+    }
+
+    JoinForwardIterator& operator++() {
+        ++inner;
+        skip_empty();
+        return *this;
+    }
+
+    JoinForwardIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return *inner;
+    }
+
+    friend bool operator==(const JoinForwardIterator& left, const JoinForwardIterator& right) {
+        return left.outer == right.outer && (left.outer == left.outer_last || left.inner == right.inner);
+    }
+
+    friend bool operator!=(const JoinForwardIterator& left, const JoinForwardIterator& right) {
+        return !(left == right);
+    }
+
+    // every inner range goes to its own push_range, so the loops over
+    // contiguous inner ranges stay pointer loops
+    template <typename Sink>
+    friend bool push_range(JoinForwardIterator first, JoinForwardIterator last, Sink& sink) {
+        if (first.outer == last.outer) {
+            return first == last || push_range(first.inner, last.inner, sink);
+        }
+        if (!push_range(first.inner, first.inner_last, sink)) {
+            return false;
+        }
+        for (++first.outer; first.outer != last.outer; ++first.outer) {
+            auto&& range = *first.outer;
+            if (!push_range(range.begin(), range.end(), sink)) {
+                return false;
+            }
+        }
+        return last.outer == last.outer_last || push_range(last.outer_begin(), last.inner, sink);
+    }
+private:
+    It outer;
+    It outer_last;
+    inner_iterator inner;
+    inner_iterator inner_last;
+
+    void enter() {
+        auto&& range = *outer;
+        inner = range.begin();
+        inner_last = range.end();
+    }
+
+    inner_iterator outer_begin() const {
+        return (*outer).begin();
+    }
+
+    void skip_empty() {
+        while (inner == inner_last) {
+            if (++outer == outer_last) {
+                return;
+            }
+            enter();
+        }
+    }
+};
+
+template <std::forward_iterator It>
+class JoinView {
+public:
+    JoinView(It beg, It last): beg(beg), last(last) {}
+
+    JoinForwardIterator<It> begin() {
+        return JoinForwardIterator<It>(beg, last);
+    }
+
+    JoinForwardIterator<It> end() {
+        return JoinForwardIterator<It>(last, last);
+    }
+private:
+    It beg;
+    It last;
+};
+
+class Join {};
+
+template <JoinableView V>
+auto operator|(V&& left, Join) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return JoinView(beg, last);
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include "adapter_concepts.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read only mapping of a whole file, pages are read by the kernel on first
+// access (ahead of it, as the file is walked from the start), so the file
+// does not have to fit into memory. Throws std::system_error if the file
+// can not be opened or mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path): data_(nullptr), size_(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw std::system_error(errno, std::generic_category(), path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) == -1) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        size_ = info.st_size;
+        // mmap refuses empty mappings, an empty file is an empty range
+        if (size_ != 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                int error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), path);
+            }
+            data_ = static_cast<const char*>(data);
+            madvise(data, size_, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+private:
+    const char* data_;
+    size_t size_;
+};
+
+// Lines of a text file without the '\n', as views into the mapping, so no
+// line is copied. A trailing '\n' does not start one more empty line.
+class MappedLineIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using distance_type = difference_type;
+    using pointer = const value_type*;
+    using reference = value_type;
+
+    MappedLineIterator(): cur(nullptr), line_end(nullptr), last(nullptr) {}
+
+    MappedLineIterator(const char* cur, const char* last): cur(cur), line_end(cur), last(last) {
+        find_end();
+    }
+
+    MappedLineIterator& operator++() {
+        cur = line_end == last ? last : line_end + 1;
+        find_end();
+        return *this;
+    }
+
+    MappedLineIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return value_type(cur, line_end - cur);
+    }
+
+    friend bool operator==(const MappedLineIterator& left, const MappedLineIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const MappedLineIterator& left, const MappedLineIterator& right) {
+        return left.cur != right.cur;
+    }
+private:
+    const char* cur;
+    const char* line_end;
+    const char* last;
+
+    void find_end() {
+        if (cur == last) {
+            line_end = last;
+            return;
+        }
+        auto found = static_cast<const char*>(std::memchr(cur, '\n', last - cur));
+        line_end = found ? found : last;
+    }
+};
+
+// The views own their mapping, an rvalue one piped into an adapter is kept
+// alive by the adapter iterators (see view_range), an lvalue one has to
+// outlive the pipeline like any container.
+class MappedLines {
+public:
+    using iterator = MappedLineIterator;
+
+    explicit MappedLines(const std::string& path): file(path) {}
+
+    iterator begin() const {
+        return iterator(file.data(), file.data() + file.size());
+    }
+
+    iterator end() const {
+        auto last = file.data() + file.size();
+        return iterator(last, last);
+    }
+private:
+    MappedFile file;
+};
+
+// A binary file of fixed size records, read in place through const T*, so
+// the whole pipeline runs as pointer loops. A partial record at the end of
+// the file is ignored.
+template <typename T>
+requires std::is_trivially_copyable_v<T>
+class MappedRecords {
+public:
+    using iterator = const T*;
+
+    explicit MappedRecords(const std::string& path): file(path) {}
+
+    iterator begin() const {
+        return reinterpret_cast<const T*>(file.data());
+    }
+
+    iterator end() const {
+        return begin() + size();
+    }
+
+    size_t size() const {
+        return file.size() / sizeof(T);
+    }
+private:
+    MappedFile file;
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+// Iterator into a container that a pipeline took by rvalue: the container
+// is moved to the heap once and every iterator shares it, so the views that
+// store iterators keep it alive and moving them does not invalidate them.
+template <std::input_iterator It, typename Container>
+class OwningIterator {
+public:
+    using iterator_category = typename std::iterator_traits<It>::iterator_category;
+    using iterator_concept = std::conditional_t<std::contiguous_iterator<It>,
+                                                std::contiguous_iterator_tag, iterator_category>;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = typename std::iterator_traits<It>::pointer;
+    using reference = std::iter_reference_t<It>;
+
+    OwningIterator(): cur(), owner() {}
+
+    OwningIterator(It it, std::shared_ptr<Container> owner): cur(it), owner(std::move(owner)) {}
+
+    OwningIterator& operator++() {
+        ++cur;
+        return *this;
+    }
+
+    OwningIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    OwningIterator& operator--() requires std::bidirectional_iterator<It> {
+        --cur;
+        return *this;
+    }
+
+    OwningIterator operator--(int) requires std::bidirectional_iterator<It> {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return *cur;
+    }
+
+    auto operator->() const requires std::contiguous_iterator<It> {
+        return std::to_address(cur);
+    }
+
+    OwningIterator& operator+=(difference_type n) requires std::random_access_iterator<It> {
+        cur += n;
+        return *this;
+    }
+
+    OwningIterator& operator-=(difference_type n) requires std::random_access_iterator<It> {
+        cur -= n;
+        return *this;
+    }
+
+    reference operator[](difference_type n) const requires std::random_access_iterator<It> {
+        return cur[n];
+    }
+
+    friend bool operator==(const OwningIterator& left, const OwningIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend auto operator<=>(const OwningIterator& left, const OwningIterator& right)
+            requires std::random_access_iterator<It> {
+        return left.cur <=> right.cur;
+    }
+
+    friend OwningIterator operator+(const OwningIterator& left, difference_type n)
+            requires std::random_access_iterator<It> {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend OwningIterator operator+(difference_type n, const OwningIterator& left)
+            requires std::random_access_iterator<It> {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend OwningIterator operator-(const OwningIterator& left, difference_type n)
+            requires std::random_access_iterator<It> {
+        auto copy = left;
+        copy -= n;
+        return copy;
+    }
+
+    friend difference_type operator-(const OwningIterator& left, const OwningIterator& right)
+            requires std::sized_sentinel_for<It, It> {
+        return left.cur - right.cur;
+    }
+
+    template <typename Sink>
+    friend bool push_range(OwningIterator first, OwningIterator last, Sink& sink) {
+        return push_range(first.cur, last.cur, sink);
+    }
+private:
+    It cur;
+    std::shared_ptr<Container> owner;
+};
+
+// containers own their elements, the views of this library only refer to
+// them, and so do borrowed ranges such as std::span and std::string_view
+template <typename V>
+concept TemporaryContainer = !std::is_lvalue_reference_v<V> && !std::ranges::borrowed_range<V> && requires {
+    typename std::remove_cvref_t<V>::iterator;
+};
+
+// The range a stage is built over: temporary containers are moved into
+// shared ownership, everything else is used in place as before.
+template <InputView V>
+auto view_range(V&& left) {
+    if constexpr (TemporaryContainer<V>) {
+        using Container = std::remove_cvref_t<V>;
+        auto owner = std::make_shared<Container>(std::move(left));
+        using Iterator = OwningIterator<decltype(owner->begin()), Container>;
+        return std::pair(Iterator(owner->begin(), owner), Iterator(owner->end(), owner));
+    } else {
+        return std::pair(left.begin(), left.end());
+    }
+}
@@ -0,0 +1,289 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+#include "cache_adapter.h"
+#include "filter_adapter.h"
+#include "transform_adapter.h"
+#include "values_adapter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Marks the source of a pipeline: the terminal operations split it into
+// parts and run the element-wise stages after it (Filter, Transform,
+// Values, Cache1) on several threads. Other stages run sequentially as usual.
+template <std::random_access_iterator It>
+class ParallelIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = std::add_pointer_t<value_type>;
+    using reference = std::iter_reference_t<It>;
+
+    ParallelIterator(): cur(), threads(1) {}
+
+    ParallelIterator(It it, size_t threads): cur(it), threads(threads) {}
+
+    ParallelIterator& operator++() {
+        ++cur;
+        return *this;
+    }
+
+    ParallelIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    ParallelIterator& operator--() {
+        --cur;
+        return *this;
+    }
+
+    ParallelIterator operator--(int) {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return *cur;
+    }
+
+    ParallelIterator& operator+=(difference_type n) {
+        cur += n;
+        return *this;
+    }
+
+    ParallelIterator& operator-=(difference_type n) {
+        cur -= n;
+        return *this;
+    }
+
+    reference operator[](difference_type n) const {
+        return cur[n];
+    }
+
+    friend bool operator==(const ParallelIterator& left, const ParallelIterator& right) {
+        return left.cur == right.cur;
+    }
+
+    friend auto operator<=>(const ParallelIterator& left, const ParallelIterator& right) {
+        return left.cur <=> right.cur;
+    }
+
+    friend ParallelIterator operator+(const ParallelIterator& left, difference_type n) {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend ParallelIterator operator+(difference_type n, const ParallelIterator& left) {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend ParallelIterator operator-(const ParallelIterator& left, difference_type n) {
+        auto copy = left;
+        copy -= n;
+        return copy;
+    }
+
+    friend difference_type operator-(const ParallelIterator& left, const ParallelIterator& right) {
+        return left.cur - right.cur;
+    }
+
+    template <typename Sink>
+    friend bool push_range(ParallelIterator first, ParallelIterator last, Sink& sink) {
+        return push_range(first.cur, last.cur, sink);
+    }
+
+    friend ParallelIterator parallel_source(const ParallelIterator& it) {
+        return it;
+    }
+
+    friend std::pair<ParallelIterator, ParallelIterator> rebase(ParallelIterator, ParallelIterator,
+                                                                ParallelIterator from, ParallelIterator to) {
+        return {from, to};
+    }
+
+    size_t get_threads() const {
+        return threads;
+    }
+private:
+    It cur;
+    size_t threads;
+};
+
+template <std::random_access_iterator It>
+class ParallelView {
+public:
+    ParallelView(It beg, It last, size_t threads): beg(beg), last(last), threads(threads) {}
+
+    ParallelIterator<It> begin() {
+        return ParallelIterator<It>(beg, threads);
+    }
+
+    ParallelIterator<It> end() {
+        return ParallelIterator<It>(last, threads);
+    }
+
+    size_t size() const {
+        return last - beg;
+    }
+private:
+    It beg;
+    It last;
+    size_t threads;
+};
+
+class Parallel {
+public:
+    // 0 takes every hardware thread
+    explicit Parallel(size_t threads = 0)
+      : threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    size_t get_threads() const {
+        return threads;
+    }
+private:
+    size_t threads;
+};
+
+template <View V>
+auto operator|(V&& left, Parallel parallel) requires std::random_access_iterator<decltype(left.begin())> {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return ParallelView(beg, last, parallel.get_threads());
+}
+
+// whether every stage between Parallel and Iter can be split
+template <typename Iter>
+struct IsParallelPipeline : std::false_type {};
+
+template <typename It>
+struct IsParallelPipeline<ParallelIterator<It>> : std::true_type {};
+
+template <typename It, typename Func>
+struct IsParallelPipeline<FilterForwardIterator<It, Func>> : IsParallelPipeline<It> {};
+
+template <typename It, typename Func>
+struct IsParallelPipeline<FilterBidirectionalIterator<It, Func>> : IsParallelPipeline<It> {};
+
+template <typename It, typename Func>
+struct IsParallelPipeline<TransformForwardIterator<It, Func>> : IsParallelPipeline<It> {};
+
+template <typename It, typename Func>
+struct IsParallelPipeline<TransformBidirectionalIterator<It, Func>> : IsParallelPipeline<It> {};
+
+template <typename It, typename Func>
+struct IsParallelPipeline<TransformRandomAccessIterator<It, Func>> : IsParallelPipeline<It> {};
+
+template <typename It>
+struct IsParallelPipeline<CacheForwardIterator<It>> : IsParallelPipeline<It> {};
+
+template <typename It>
+struct IsParallelPipeline<CacheBidirectionalIterator<It>> : IsParallelPipeline<It> {};
+
+template <size_t N, typename It>
+struct IsParallelPipeline<ValuesForwardIterator<N, It>> : IsParallelPipeline<It> {};
+
+template <size_t N, typename It>
+struct IsParallelPipeline<ValuesBidirectionalIterator<N, It>> : IsParallelPipeline<It> {};
+
+template <size_t N, typename It>
+struct IsParallelPipeline<ValuesRandomAccessIterator<N, It>> : IsParallelPipeline<It> {};
+
+template <typename Iter>
+concept ParallelPipeline = IsParallelPipeline<Iter>::value;
+
+// every thread gets several parts, so uneven filters cost little idle time
+const size_t kPartsPerThread = 8;
+const size_t kMinPartSize = 1024;
+
+template <ParallelPipeline Iter>
+size_t part_count(Iter first, Iter last) {
+    auto from = parallel_source(first);
+    size_t size = parallel_source(last) - from;
+    return std::clamp<size_t>(size / kMinPartSize, 1, from.get_threads() * kPartsPerThread);
+}
+
+// Calls job(i, part_first, part_last) for each of parts consecutive parts
+// of the source, workers claim the next unprocessed part when they are done
+// with one, so a slow part does not hold the others. The first exception
+// thrown by a job stops handing out parts and is rethrown once every worker
+// has been joined.
+template <ParallelPipeline Iter, typename Job>
+void run_parts(Iter first, Iter last, size_t parts, Job job) {
+    auto from = parallel_source(first);
+    auto size = parallel_source(last) - from;
+    std::atomic<size_t> next_part = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto work = [&] {
+        try {
+            for (size_t i = next_part++; i < parts; i = next_part++) {
+                auto [part_first, part_last] = rebase(first, last, from + size * i / parts,
+                                                      from + size * (i + 1) / parts);
+                job(i, part_first, part_last);
+            }
+        } catch (...) {
+            next_part = parts;
+            std::lock_guard lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    size_t threads = std::min(from.get_threads(), parts);
+    {
+        // joined when the scope ends
+        std::vector<std::jthread> workers;
+        try {
+            for (size_t i = 0; i + 1 < threads; ++i) {
+                workers.emplace_back(work);
+            }
+        } catch (const std::system_error&) {
+            // the parts left are shared by the workers already running
+        }
+        work();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Runs consume(part_first, part_last, state) over the parts of the pipeline
+// with a state from make_state for each part, the states keep the order of
+// the parts in the source.
+template <ParallelPipeline Iter, typename MakeState, typename Consume>
+auto run_parallel(Iter first, Iter last, MakeState make_state, Consume consume) {
+    std::vector<decltype(make_state())> states;
+    if (first == last) {
+        return states;
+    }
+    size_t parts = part_count(first, last);
+    states.reserve(parts);
+    for (size_t i = 0; i < parts; ++i) {
+        states.push_back(make_state());
+    }
+    run_parts(first, last, parts, [&](size_t i, auto part_first, auto part_last) {
+        // a local state can stay in registers, one in the vector may alias the source
+        auto state = std::move(states[i]);
+        consume(part_first, part_last, state);
+        states[i] = std::move(state);
+    });
+    return states;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "drop_adapter.h"
+#include "take_adapter.h"
+#include "filter_adapter.h"
+#include "reverse_adapter.h"
+#include "values_adapter.h"
+#include "transform_adapter.h"
+#include "cache_adapter.h"
+#include "chunk_adapter.h"
+#include "batch_adapter.h"
+#include "zip_adapter.h"
+#include "enumerate_adapter.h"
+#include "join_adapter.h"
+#include "async_adapter.h"
+#include "parallel_adapter.h"
+#include "terminal_adapter.h"
+
+#include <type_traits>
+#include <utility>
+
+// Adapters piped into each other without a view make a closure that is
+// applied later: auto p = Filter(f) | Transform(g) | Take(10); v | p.
+// Neighbours that have a fuse overload are merged while the closure is
+// built, so Transform | Transform keeps one function and one iterator
+// layer, the same as v | Transform(f) | Transform(g) does on views.
+template <typename Left, typename Right>
+class Pipeline {
+public:
+    Pipeline(Left left, Right right): left(left), right(right) {}
+
+    [[no_unique_address]] Left left;
+    [[no_unique_address]] Right right;
+};
+
+template <typename T>
+struct IsAdapter : std::false_type {};
+
+template <typename Func>
+struct IsAdapter<Filter<Func>> : std::true_type {};
+
+template <typename Func>
+struct IsAdapter<Transform<Func>> : std::true_type {};
+
+template <>
+struct IsAdapter<Take> : std::true_type {};
+
+template <>
+struct IsAdapter<Drop> : std::true_type {};
+
+template <>
+struct IsAdapter<Reverse> : std::true_type {};
+
+template <size_t N>
+struct IsAdapter<Values<N>> : std::true_type {};
+
+template <>
+struct IsAdapter<Cache1> : std::true_type {};
+
+template <>
+struct IsAdapter<Chunk> : std::true_type {};
+
+template <>
+struct IsAdapter<Batch> : std::true_type {};
+
+template <typename Func>
+struct IsAdapter<TransformBatch<Func>> : std::true_type {};
+
+template <typename It>
+struct IsAdapter<Zip<It>> : std::true_type {};
+
+template <>
+struct IsAdapter<Enumerate> : std::true_type {};
+
+template <>
+struct IsAdapter<Join> : std::true_type {};
+
+template <>
+struct IsAdapter<Async> : std::true_type {};
+
+template <>
+struct IsAdapter<Parallel> : std::true_type {};
+
+// terminals may only end a closure
+template <typename Func>
+struct IsAdapter<ForEach<Func>> : std::true_type {};
+
+template <typename T, typename Op>
+struct IsAdapter<Reduce<T, Op>> : std::true_type {};
+
+template <>
+struct IsAdapter<Count> : std::true_type {};
+
+template <typename Container>
+struct IsAdapter<To<Container>> : std::true_type {};
+
+template <typename Left, typename Right>
+struct IsAdapter<Pipeline<Left, Right>> : std::true_type {};
+
+template <typename T>
+concept Adapter = IsAdapter<T>::value;
+
+template <typename Left, typename Right>
+concept Fusable = requires(Left left, Right right) {
+    fuse(left, right);
+};
+
+template <typename T>
+struct IsPipeline : std::false_type {};
+
+template <typename Left, typename Right>
+struct IsPipeline<Pipeline<Left, Right>> : std::true_type {};
+
+// closures are kept left leaning, so the adapter being appended only
+// has to be checked against the last one
+template <Adapter Left, Adapter Right>
+auto operator|(Left left, Right right) {
+    if constexpr (IsPipeline<Right>::value) {
+        return left | right.left | right.right;
+    } else if constexpr (Fusable<Left, Right>) {
+        return fuse(left, right);
+    } else if constexpr (IsPipeline<Left>::value) {
+        if constexpr (Fusable<decltype(left.right), Right>) {
+            return left.left | fuse(left.right, right);
+        } else {
+            return Pipeline<Left, Right>(left, right);
+        }
+    } else {
+        return Pipeline<Left, Right>(left, right);
+    }
+}
+
+template <InputView V, typename Left, typename Right>
+auto operator|(V&& view, const Pipeline<Left, Right>& pipeline) {
+    return std::forward<V>(view) | pipeline.left | pipeline.right;
+}
@@ -1,8 +1,10 @@
 #pragma once
 #include "adapter_concepts.h"
+#include "owning_iterator.h"
 
 #include <concepts>
 #include <iterator>
+#include <utility>
 
 template <std::bidirectional_iterator It>
 class ReverseView {
@@ -16,6 +18,10 @@ public:
     It end() {
         return last;
     }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return last - beg;
+    }
 private:
     It beg;
     It last;
@@ -25,8 +31,9 @@ class Reverse {};
 
 template <BidirectionalView V>
 auto operator|(V&& left, Reverse right) {
-    auto rev_end = std::reverse_iterator(left.begin());
-    auto rev_begin = std::reverse_iterator(left.end());
+    auto [beg, last] = view_range(std::forward<V>(left));
+    auto rev_end = std::reverse_iterator(beg);
+    auto rev_begin = std::reverse_iterator(last);
 
     return ReverseView(rev_begin, rev_end);
 }
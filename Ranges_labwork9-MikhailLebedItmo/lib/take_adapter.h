@@ -1,36 +1,234 @@
 #pragma once
 #include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
 
+#include <algorithm>
 #include <iterator>
+#include <utility>
 
-template <std::forward_iterator It>
+// Counts the taken elements instead of looking for the n-th one up front,
+// the end is the iterator that ran out of count or reached last. The last
+// taken step does not move the underlying iterator, so take(1) of a filter
+// never searches for a second match.
+template <std::input_iterator It>
+class TakeForwardIterator {
+public:
+    using iterator_category = ForwardOrInputTag<It>;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = std::add_pointer_t<value_type>;
+    using reference = std::iter_reference_t<It>;
+
+    TakeForwardIterator(): cur(), last(), left(0) {}
+
+    TakeForwardIterator(It cur, It last, size_t left): cur(cur), last(last), left(left) {}
+
+    TakeForwardIterator& operator++() {
+        if (--left != 0) {
+            ++cur;
+        }
+        return *this;
+    }
+
+    TakeForwardIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return *cur;
+    }
+
+    friend bool operator==(const TakeForwardIterator& left, const TakeForwardIterator& right) {
+        if (left.at_end() || right.at_end()) {
+            return left.at_end() == right.at_end();
+        }
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const TakeForwardIterator& left, const TakeForwardIterator& right) {
+        return !(left == right);
+    }
+
+    // the count replaces the end check of the underlying range
+    template <typename Sink>
+    friend bool push_range(TakeForwardIterator first, TakeForwardIterator last, Sink& sink) {
+        if (!last.at_end()) {
+            return push_loop(first, last, sink);
+        }
+        if (first.at_end()) {
+            return true;
+        }
+        size_t remaining = first.left;
+        bool pushed = true;
+        auto counted = [&remaining, &pushed, &sink](auto&& value) {
+            pushed = sink(std::forward<decltype(value)>(value));
+            return pushed && --remaining != 0;
+        };
+        push_range(first.cur, first.last, counted);
+        return pushed;
+    }
+private:
+    It cur;
+    It last;
+    size_t left;
+
+    bool at_end() const {
+        return left == 0 || cur == last;
+    }
+};
+
+// The end iterator does not know where it is until it is decremented, then
+// it walks from the first element once. After the n-th step cur stays on
+// the last taken element like in TakeForwardIterator.
+template <std::bidirectional_iterator It>
+class TakeBidirectionalIterator {
+public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::iter_value_t<It>;
+    using difference_type = std::iter_difference_t<It>;
+    using distance_type = difference_type;
+    using pointer = std::add_pointer_t<value_type>;
+    using reference = std::iter_reference_t<It>;
+
+    TakeBidirectionalIterator(): cur(), last(), index(0), n(0), placed(true) {}
+
+    TakeBidirectionalIterator(It cur, It last, size_t index, size_t n, bool placed)
+      : cur(cur), last(last), index(index), n(n), placed(placed) {}
+
+    TakeBidirectionalIterator& operator++() {
+        if (++index != n) {
+            ++cur;
+        }
+        return *this;
+    }
+
+    TakeBidirectionalIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    TakeBidirectionalIterator& operator--() {
+        if (!placed) {
+            index = 0;
+            for (auto next = std::next(cur); index + 1 < n && next != last; ++next) {
+                cur = next;
+                ++index;
+            }
+            placed = true;
+            return *this;
+        }
+        if (index != n) {
+            --cur;
+        }
+        --index;
+        return *this;
+    }
+
+    TakeBidirectionalIterator operator--(int) {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return *cur;
+    }
+
+    friend bool operator==(const TakeBidirectionalIterator& left, const TakeBidirectionalIterator& right) {
+        if (left.at_end() || right.at_end()) {
+            return left.at_end() == right.at_end();
+        }
+        return left.cur == right.cur;
+    }
+
+    friend bool operator!=(const TakeBidirectionalIterator& left, const TakeBidirectionalIterator& right) {
+        return !(left == right);
+    }
+
+    // the count replaces the end check of the underlying range
+    template <typename Sink>
+    friend bool push_range(TakeBidirectionalIterator first, TakeBidirectionalIterator last, Sink& sink) {
+        if (!last.at_end()) {
+            return push_loop(first, last, sink);
+        }
+        if (first.at_end()) {
+            return true;
+        }
+        size_t remaining = first.n - first.index;
+        bool pushed = true;
+        auto counted = [&remaining, &pushed, &sink](auto&& value) {
+            pushed = sink(std::forward<decltype(value)>(value));
+            return pushed && --remaining != 0;
+        };
+        push_range(first.cur, first.last, counted);
+        return pushed;
+    }
+private:
+    It cur;
+    It last;
+    size_t index;
+    size_t n;
+    // false for the end iterator that still points to the first element
+    bool placed;
+
+    bool at_end() const {
+        return index == n || cur == last;
+    }
+};
+
+class Take;
+
+// Construction is O(1), elements are only walked while the view is consumed.
+template <std::input_iterator It>
 class TakeView {
 public:
-    TakeView(It beg, It last, size_t n): beg(beg), last(last) {
+    TakeView(It beg, It last, size_t n): beg(beg), last(last), n(n) {
         if constexpr (std::random_access_iterator<It>) {
             if (last - beg > n) {
                 this->last = beg + n;
             }
+        }
+    }
+
+    auto begin() {
+        if constexpr (std::random_access_iterator<It>) {
+            return beg;
+        } else if constexpr (std::bidirectional_iterator<It>) {
+            return TakeBidirectionalIterator<It>(beg, last, 0, n, true);
         } else {
-            auto new_last = beg;
-            while (n > 0 && new_last != last) {
-                --n;
-                ++new_last;
-            }
-            this->last = new_last;
+            return TakeForwardIterator<It>(beg, last, n);
         }
     }
 
-    It begin() {
-        return beg;
+    auto end() {
+        if constexpr (std::random_access_iterator<It>) {
+            return last;
+        } else if constexpr (std::bidirectional_iterator<It>) {
+            return TakeBidirectionalIterator<It>(beg, last, n, n, false);
+        } else {
+            return TakeForwardIterator<It>(last, last, 0);
+        }
+    }
+
+    size_t size() const requires std::random_access_iterator<It> {
+        return last - beg;
     }
 
-    It end() {
-        return last;
+    auto data() const requires std::contiguous_iterator<It> {
+        return std::to_address(beg);
     }
+
+    template <std::input_iterator I>
+    friend auto operator|(TakeView<I> left, Take right);
 private:
     It beg;
     It last;
+    size_t n;
 };
 
 class Take {
@@ -39,7 +237,17 @@ public:
     explicit Take(size_t n): n(n) {}
 };
 
-template <View V>
+template <InputView V>
 auto operator|(V&& left, Take take) {
-    return TakeView(left.begin(), left.end(), take.n);
-}
\ No newline at end of file
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return TakeView(beg, last, take.n);
+}
+
+template <std::input_iterator It>
+auto operator|(TakeView<It> left, Take right) {
+    return TakeView<It>(left.beg, left.last, std::min(left.n, right.n));
+}
+
+inline Take fuse(Take left, Take right) {
+    return Take(std::min(left.n, right.n));
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "parallel_adapter.h"
+#include "utils.h"
+
+#include <functional>
+#include <optional>
+#include <utility>
+
+// Terminal operations end a pipeline and consume it with push_range, so
+// the adapters run as one loop over the source instead of nested iterators.
+// After Parallel the parts of the source are consumed on several threads
+// and the partial results are merged in the source order.
+
+template <typename Func>
+class ForEach {
+public:
+    explicit ForEach(Func func): func(func) {}
+
+    Func get_func() const {
+        return func;
+    }
+private:
+    [[no_unique_address]] Func func;
+};
+
+// after Parallel func is called from several threads in no particular order
+template <InputView V, typename Func>
+void operator|(V&& left, ForEach<Func> for_each) {
+    auto func = for_each.get_func();
+    auto consume = [&func](auto first, auto last) {
+        auto sink = [&func](auto&& value) {
+            func(std::forward<decltype(value)>(value));
+            return true;
+        };
+        push_range(first, last, sink);
+    };
+    if constexpr (ParallelPipeline<decltype(left.begin())>) {
+        run_parallel(left.begin(), left.end(), [] { return 0; }, [&consume](auto first, auto last, int) {
+            consume(first, last);
+        });
+    } else {
+        consume(left.begin(), left.end());
+    }
+}
+
+// after Parallel every part is folded from its own first element and the
+// partial results are folded into init in the source order, so op has to be
+// associative and the elements convertible to T, init is used once as usual
+template <typename T, typename Op = std::plus<>>
+class Reduce {
+public:
+    explicit Reduce(T init, Op op = Op()): init(std::move(init)), op(op) {}
+
+    T get_init() const {
+        return init;
+    }
+
+    Op get_op() const {
+        return op;
+    }
+private:
+    T init;
+    [[no_unique_address]] Op op;
+};
+
+template <InputView V, typename T, typename Op>
+T operator|(V&& left, Reduce<T, Op> reduce) {
+    auto op = reduce.get_op();
+    T result = reduce.get_init();
+    if constexpr (ParallelPipeline<decltype(left.begin())>) {
+        auto consume_part = [&op](auto first, auto last, std::optional<T>& part) {
+            auto sink = [&part, &op](auto&& value) {
+                if (part) {
+                    *part = op(std::move(*part), std::forward<decltype(value)>(value));
+                } else {
+                    part.emplace(std::forward<decltype(value)>(value));
+                }
+                return true;
+            };
+            push_range(first, last, sink);
+        };
+        auto parts = run_parallel(left.begin(), left.end(), [] { return std::optional<T>(); }, consume_part);
+        for (auto& part: parts) {
+            if (part) {
+                result = op(std::move(result), std::move(*part));
+            }
+        }
+    } else {
+        auto sink = [&result, &op](auto&& value) {
+            result = op(std::move(result), std::forward<decltype(value)>(value));
+            return true;
+        };
+        push_range(left.begin(), left.end(), sink);
+    }
+    return result;
+}
+
+class Count {};
+
+template <InputView V>
+size_t operator|(V&& left, Count) {
+    auto consume = [](auto first, auto last, size_t& result) {
+        auto sink = [&result](auto&&) {
+            ++result;
+            return true;
+        };
+        push_range(first, last, sink);
+    };
+    size_t result = 0;
+    if constexpr (ParallelPipeline<decltype(left.begin())>) {
+        for (size_t part: run_parallel(left.begin(), left.end(), [] { return size_t(0); }, consume)) {
+            result += part;
+        }
+    } else {
+        consume(left.begin(), left.end(), result);
+    }
+    return result;
+}
+
+// reserves the whole result up front when the view knows its size
+template <typename Container>
+class To {};
+
+template <InputView V, typename Container>
+Container operator|(V&& left, To<Container>) {
+    auto add = [](Container& result, auto&& value) {
+        if constexpr (requires { result.push_back(std::forward<decltype(value)>(value)); }) {
+            result.push_back(std::forward<decltype(value)>(value));
+        } else {
+            result.insert(std::forward<decltype(value)>(value));
+        }
+    };
+    auto consume = [&add](auto first, auto last, Container& result) {
+        auto sink = [&add, &result](auto&& value) {
+            add(result, std::forward<decltype(value)>(value));
+            return true;
+        };
+        push_range(first, last, sink);
+    };
+    Container result;
+    if constexpr (ParallelPipeline<decltype(left.begin())>) {
+        auto parts = run_parallel(left.begin(), left.end(), [] { return Container(); }, consume);
+        if constexpr (requires { result.reserve(size_t()); }) {
+            size_t size = 0;
+            for (auto& part: parts) {
+                size += part.size();
+            }
+            result.reserve(size);
+        }
+        for (auto& part: parts) {
+            for (auto& value: part) {
+                add(result, std::move(value));
+            }
+        }
+    } else {
+        if constexpr (SizedView<V> && requires { result.reserve(size_t()); }) {
+            result.reserve(left.size());
+        }
+        consume(left.begin(), left.end(), result);
+    }
+    return result;
+}
@@ -1,13 +1,31 @@
 #pragma once
 #include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
 
 #include <concepts>
 #include <iterator>
+#include <utility>
 
-template <std::forward_iterator It, TransformFunc<It> Func>
+template <typename Func>
+class Transform;
+
+// g(f(x)), what two stacked transforms compute in one call
+template <typename First, typename Second>
+struct Composition {
+    [[no_unique_address]] First first;
+    [[no_unique_address]] Second second;
+
+    template <typename T>
+    decltype(auto) operator()(T&& value) const {
+        return second(first(std::forward<T>(value)));
+    }
+};
+
+template <std::input_iterator It, TransformFunc<It> Func>
 class TransformForwardIterator{
 public:
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = ForwardOrInputTag<It>;
     using value_type = decltype(std::declval<Func>()(*std::declval<It>()));
     using difference_type = std::iter_difference_t<It>;
     using distance_type = difference_type;
@@ -40,6 +58,24 @@ public:
     friend bool operator!=(const TransformForwardIterator& left, const TransformForwardIterator& right) {
         return left.cur != right.cur;
     }
+
+    template <typename Sink>
+    friend bool push_range(TransformForwardIterator first, TransformForwardIterator last, Sink& sink) {
+        auto transformed = [&first, &sink](auto&& value) {
+            return sink(first.transform(std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, transformed);
+    }
+
+    friend auto parallel_source(const TransformForwardIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<TransformForwardIterator, TransformForwardIterator> rebase(TransformForwardIterator first, TransformForwardIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {TransformForwardIterator(cur, first.transform), TransformForwardIterator(end, first.transform)};
+    }
 private:
     It cur;
     [[no_unique_address]] Func transform;
@@ -93,6 +129,24 @@ public:
     friend bool operator!=(const TransformBidirectionalIterator& left, const TransformBidirectionalIterator& right) {
         return left.cur != right.cur;
     }
+
+    template <typename Sink>
+    friend bool push_range(TransformBidirectionalIterator first, TransformBidirectionalIterator last, Sink& sink) {
+        auto transformed = [&first, &sink](auto&& value) {
+            return sink(first.transform(std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, transformed);
+    }
+
+    friend auto parallel_source(const TransformBidirectionalIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<TransformBidirectionalIterator, TransformBidirectionalIterator> rebase(TransformBidirectionalIterator first, TransformBidirectionalIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {TransformBidirectionalIterator(cur, first.transform), TransformBidirectionalIterator(end, first.transform)};
+    }
 private:
     It cur;
     [[no_unique_address]] Func transform;
@@ -161,6 +215,24 @@ public:
         return left.cur != right.cur;
     }
 
+    template <typename Sink>
+    friend bool push_range(TransformRandomAccessIterator first, TransformRandomAccessIterator last, Sink& sink) {
+        auto transformed = [&first, &sink](auto&& value) {
+            return sink(first.transform(std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, transformed);
+    }
+
+    friend auto parallel_source(const TransformRandomAccessIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<TransformRandomAccessIterator, TransformRandomAccessIterator> rebase(TransformRandomAccessIterator first, TransformRandomAccessIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {TransformRandomAccessIterator(cur, first.transform), TransformRandomAccessIterator(end, first.transform)};
+    }
+
     friend bool operator<(const TransformRandomAccessIterator& left, const TransformRandomAccessIterator& right) {
         return left.cur < right.cur;
     }
@@ -200,12 +272,16 @@ public:
         copy -= n;
         return copy;
     }
+
+    friend difference_type operator-(const TransformRandomAccessIterator& left, const TransformRandomAccessIterator& right) {
+        return left.cur - right.cur;
+    }
 private:
     It cur;
     [[no_unique_address]] Func transform;
 };
 
-template <std::forward_iterator It, TransformFunc<It> Func>
+template <std::input_iterator It, TransformFunc<It> Func>
 class TransformView {
 public:
     TransformView(It beg, It last, Func transform)
@@ -230,6 +306,13 @@ public:
             return TransformForwardIterator(last, transform);
         }
     }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return last - beg;
+    }
+
+    template <std::input_iterator I, typename F, typename Next>
+    friend auto operator|(TransformView<I, F> left, Transform<Next> right);
 private:
     It beg;
     It last;
@@ -248,7 +331,20 @@ private:
     [[no_unique_address]] Func transform;
 };
 
-template <View V, TransformFunc<decltype(std::declval<V>().begin())> Func>
+template <InputView V, TransformFunc<decltype(std::declval<V>().begin())> Func>
 auto operator|(V&& left, Transform<Func> filter) {
-    return TransformView(left.begin(), left.end(), filter.get_transform());
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return TransformView(beg, last, filter.get_transform());
+}
+
+// a transform of a transform is one layer over the same iterators
+template <std::input_iterator It, typename Func, typename Next>
+auto operator|(TransformView<It, Func> left, Transform<Next> right) {
+    using Fused = Composition<Func, Next>;
+    return TransformView<It, Fused>(left.beg, left.last, Fused{left.transform, right.get_transform()});
+}
+
+template <typename Func, typename Next>
+auto fuse(Transform<Func> left, Transform<Next> right) {
+    return Transform(Composition<Func, Next>{left.get_transform(), right.get_transform()});
 }
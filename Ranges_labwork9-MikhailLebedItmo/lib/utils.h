@@ -57,4 +57,34 @@ void my_advance(It& it, std::iter_difference_t<It> n, End bound) {
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// Internal iteration over [first, last): sink gets every element until it
+// returns false, the result tells whether the whole range was pushed.
+template <typename It, typename Sink>
+bool push_loop(It first, It last, Sink& sink) {
+    if constexpr (std::contiguous_iterator<It>) {
+        auto end = std::to_address(last);
+        for (auto cur = std::to_address(first); cur != end; ++cur) {
+            if (!sink(*cur)) {
+                return false;
+            }
+        }
+    } else {
+        for (; first != last; ++first) {
+            if (!sink(*first)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Adapter iterators overload push_range as hidden friends: they wrap the
+// sink into their own step and push the underlying range instead, so a
+// whole pipeline becomes one loop over the source without per-layer
+// bound checks.
+template <typename It, typename Sink>
+bool push_range(It first, It last, Sink& sink) {
+    return push_loop(first, last, sink);
+}
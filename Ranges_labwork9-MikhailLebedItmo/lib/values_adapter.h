@@ -1,7 +1,19 @@
 #pragma once
 #include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
 #include <iterator>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+
+// a tuple returned by value dies with the full expression, so its
+// element is returned by value too instead of as a dangling reference
+template <size_t N, typename It>
+using ValuesReference = std::conditional_t<
+        std::is_lvalue_reference_v<std::iter_reference_t<It>>,
+        decltype(std::get<N>(*std::declval<It>())),
+        std::remove_cv_t<std::tuple_element_t<N, std::remove_cvref_t<std::iter_reference_t<It>>>>>;
 
 template <size_t N, std::forward_iterator It>
 class ValuesForwardIterator {
@@ -9,8 +21,8 @@ public:
     using iterator_category = std::forward_iterator_tag;
     using difference_type = std::iter_difference_t<It>;
     using distance_type = difference_type;
-    using reference = decltype(std::get<N>(*std::declval<It>()));
-    using value_type = std::remove_cvref<reference>;
+    using reference = ValuesReference<N, It>;
+    using value_type = std::remove_cvref_t<reference>;
     using pointer = value_type*;
 
     ValuesForwardIterator(): cur() {}
@@ -39,6 +51,24 @@ public:
     friend bool operator!=(const ValuesForwardIterator& left, const ValuesForwardIterator& right) {
         return left.cur != right.cur;
     }
+
+    template <typename Sink>
+    friend bool push_range(ValuesForwardIterator first, ValuesForwardIterator last, Sink& sink) {
+        auto projected = [&sink](auto&& value) {
+            return sink(std::get<N>(std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, projected);
+    }
+
+    friend auto parallel_source(const ValuesForwardIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<ValuesForwardIterator, ValuesForwardIterator> rebase(ValuesForwardIterator first, ValuesForwardIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {ValuesForwardIterator(cur), ValuesForwardIterator(end)};
+    }
 private:
     It cur;
 };
@@ -49,7 +79,7 @@ public:
     using iterator_category = std::bidirectional_iterator_tag;
     using difference_type = std::iter_difference_t<It>;
     using distance_type = difference_type;
-    using reference = decltype(std::get<N>(*std::declval<It>()));
+    using reference = ValuesReference<N, It>;
     using value_type = std::remove_cvref_t<reference>;
     using pointer = value_type*;
 
@@ -90,6 +120,24 @@ public:
     friend bool operator!=(const ValuesBidirectionalIterator& left, const ValuesBidirectionalIterator& right) {
         return left.cur != right.cur;
     }
+
+    template <typename Sink>
+    friend bool push_range(ValuesBidirectionalIterator first, ValuesBidirectionalIterator last, Sink& sink) {
+        auto projected = [&sink](auto&& value) {
+            return sink(std::get<N>(std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, projected);
+    }
+
+    friend auto parallel_source(const ValuesBidirectionalIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<ValuesBidirectionalIterator, ValuesBidirectionalIterator> rebase(ValuesBidirectionalIterator first, ValuesBidirectionalIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {ValuesBidirectionalIterator(cur), ValuesBidirectionalIterator(end)};
+    }
 private:
     It cur;
 };
@@ -100,7 +148,7 @@ public:
     using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::iter_difference_t<It>;
     using distance_type = difference_type;
-    using reference = decltype(std::get<N>(*std::declval<It>()));
+    using reference = ValuesReference<N, It>;
     using value_type = std::remove_cvref_t<reference>;
     using pointer = value_type*;
 
@@ -148,7 +196,25 @@ public:
         return std::get<N>(*(cur + n));
     }
 
-    friend bool operator <=>(const ValuesRandomAccessIterator&, const ValuesRandomAccessIterator&) = default;
+    friend auto operator<=>(const ValuesRandomAccessIterator&, const ValuesRandomAccessIterator&) = default;
+
+    template <typename Sink>
+    friend bool push_range(ValuesRandomAccessIterator first, ValuesRandomAccessIterator last, Sink& sink) {
+        auto projected = [&sink](auto&& value) {
+            return sink(std::get<N>(std::forward<decltype(value)>(value)));
+        };
+        return push_range(first.cur, last.cur, projected);
+    }
+
+    friend auto parallel_source(const ValuesRandomAccessIterator& it) {
+        return parallel_source(it.cur);
+    }
+
+    template <typename Source>
+    friend std::pair<ValuesRandomAccessIterator, ValuesRandomAccessIterator> rebase(ValuesRandomAccessIterator first, ValuesRandomAccessIterator last, Source from, Source to) {
+        auto [cur, end] = rebase(first.cur, last.cur, from, to);
+        return {ValuesRandomAccessIterator(cur), ValuesRandomAccessIterator(end)};
+    }
 
     friend ValuesRandomAccessIterator operator+(const ValuesRandomAccessIterator& left, size_t n) {
         auto copy = left;
@@ -173,6 +239,10 @@ public:
         copy -= n;
         return copy;
     }
+
+    friend difference_type operator-(const ValuesRandomAccessIterator& left, const ValuesRandomAccessIterator& right) {
+        return left.cur - right.cur;
+    }
 private:
     It cur;
 };
@@ -204,6 +274,10 @@ public:
             return ValuesForwardIterator<N, It>(last);
         }
     }
+
+    size_t size() const requires std::sized_sentinel_for<It, It> {
+        return last - beg;
+    }
 private:
     It beg;
     It last;
@@ -211,5 +285,6 @@ private:
 
 template <size_t N, TupleLikeView<N> V>
 auto operator|(V&& left, Values<N> right) {
-    return ValuesView(right, left.begin(), left.end());
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return ValuesView(right, beg, last);
 }
\ No newline at end of file
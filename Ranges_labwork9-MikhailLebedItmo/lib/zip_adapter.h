@@ -0,0 +1,174 @@
+#pragma once
+#include "adapter_concepts.h"
+#include "utils.h"
+#include "owning_iterator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+// Pairs up the elements of two ranges until the shorter one ends. The
+// pairs hold references, so Keys/Values over a Zip read the sources in
+// place. Random access when both sources are.
+template <std::forward_iterator First, std::forward_iterator Second>
+class ZipIterator {
+public:
+    static constexpr bool kRandomAccess = std::random_access_iterator<First> && std::random_access_iterator<Second>;
+
+    using iterator_category = std::conditional_t<kRandomAccess, std::random_access_iterator_tag,
+                                                 std::forward_iterator_tag>;
+    using value_type = std::pair<std::iter_value_t<First>, std::iter_value_t<Second>>;
+    using difference_type = std::common_type_t<std::iter_difference_t<First>, std::iter_difference_t<Second>>;
+    using distance_type = difference_type;
+    using pointer = value_type*;
+    using reference = std::pair<std::iter_reference_t<First>, std::iter_reference_t<Second>>;
+
+    ZipIterator(): first(), second() {}
+
+    ZipIterator(First first, Second second): first(first), second(second) {}
+
+    ZipIterator& operator++() {
+        ++first;
+        ++second;
+        return *this;
+    }
+
+    ZipIterator operator++(int) {
+        auto copy = *this;
+        ++(*this);
+        return copy;
+    }
+
+    ZipIterator& operator--() requires kRandomAccess {
+        --first;
+        --second;
+        return *this;
+    }
+
+    ZipIterator operator--(int) requires kRandomAccess {
+        auto copy = *this;
+        --(*this);
+        return copy;
+    }
+
+    reference operator*() const {
+        return reference(*first, *second);
+    }
+
+    ZipIterator& operator+=(difference_type n) requires kRandomAccess {
+        first += n;
+        second += n;
+        return *this;
+    }
+
+    ZipIterator& operator-=(difference_type n) requires kRandomAccess {
+        first -= n;
+        second -= n;
+        return *this;
+    }
+
+    reference operator[](difference_type n) const requires kRandomAccess {
+        return reference(first[n], second[n]);
+    }
+
+    // either source running out ends the zip
+    friend bool operator==(const ZipIterator& left, const ZipIterator& right) {
+        return left.first == right.first || left.second == right.second;
+    }
+
+    friend auto operator<=>(const ZipIterator& left, const ZipIterator& right)
+            requires kRandomAccess {
+        return left.first <=> right.first;
+    }
+
+    friend ZipIterator operator+(const ZipIterator& left, difference_type n)
+            requires kRandomAccess {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend ZipIterator operator+(difference_type n, const ZipIterator& left)
+            requires kRandomAccess {
+        auto copy = left;
+        copy += n;
+        return copy;
+    }
+
+    friend ZipIterator operator-(const ZipIterator& left, difference_type n)
+            requires kRandomAccess {
+        auto copy = left;
+        copy -= n;
+        return copy;
+    }
+
+    friend difference_type operator-(const ZipIterator& left, const ZipIterator& right)
+            requires kRandomAccess {
+        return left.first - right.first;
+    }
+private:
+    First first;
+    Second second;
+};
+
+template <std::forward_iterator First, std::forward_iterator Second>
+class ZipView {
+public:
+    ZipView(First beg1, First last1, Second beg2, Second last2)
+      : beg1(beg1), last1(last1), beg2(beg2), last2(last2) {
+        // equal lengths give the random access end one position for both
+        if constexpr (ZipIterator<First, Second>::kRandomAccess) {
+            auto size = std::min<std::common_type_t<std::iter_difference_t<First>, std::iter_difference_t<Second>>>(
+                    last1 - beg1, last2 - beg2);
+            this->last1 = beg1 + size;
+            this->last2 = beg2 + size;
+        }
+    }
+
+    ZipIterator<First, Second> begin() {
+        return ZipIterator<First, Second>(beg1, beg2);
+    }
+
+    ZipIterator<First, Second> end() {
+        return ZipIterator<First, Second>(last1, last2);
+    }
+
+    size_t size() const requires std::sized_sentinel_for<First, First> && std::sized_sentinel_for<Second, Second> {
+        return std::min<size_t>(last1 - beg1, last2 - beg2);
+    }
+private:
+    First beg1;
+    First last1;
+    Second beg2;
+    Second last2;
+};
+
+template <std::forward_iterator It>
+class Zip {
+public:
+    template <View V>
+    explicit Zip(V&& other) {
+        std::tie(beg, last) = view_range(std::forward<V>(other));
+    }
+
+    It get_begin() const {
+        return beg;
+    }
+
+    It get_end() const {
+        return last;
+    }
+private:
+    It beg;
+    It last;
+};
+
+template <View V>
+Zip(V&&) -> Zip<typename decltype(view_range(std::declval<V>()))::first_type>;
+
+template <View V, typename It>
+auto operator|(V&& left, Zip<It> zip) {
+    auto [beg, last] = view_range(std::forward<V>(left));
+    return ZipView(beg, last, zip.get_begin(), zip.get_end());
+}
@@ -3,12 +3,27 @@
 #include <gmock/gmock.h>
 
 #include <vector>
+#include <unistd.h>
 #include <forward_list>
+#include <limits>
 #include <list>
 #include <ranges>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
 
 #include "../lib/adapters.h"
+#include "../lib/mapped_source.h"
 
 
 
@@ -397,6 +412,58 @@ TEST(Take, AlgorithmStd) {
     ASSERT_EQ(my_res, real_res);
 }
 
+TEST(Take, Lazy) {
+    std::list<int> data{1, 2, 3, 4, 5, 6, 7, 8};
+    static size_t calls;
+    calls = 0;
+    auto predicate = [](int x){++calls; return x % 2 == 0;};
+    auto my_view = data | Filter(predicate) | Take(2);
+    // only Filter looks for its first match
+    ASSERT_EQ(calls, 2);
+    std::vector<int> my_res;
+    for (auto x: my_view) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({2, 4}));
+    ASSERT_EQ(calls, 4);
+    std::vector<int> my_res_reverse;
+    for (auto it = std::reverse_iterator(my_view.end()); it != std::reverse_iterator(my_view.begin()); ++it) {
+        my_res_reverse.push_back(*it);
+    }
+    ASSERT_EQ(my_res_reverse, std::vector<int>({4, 2}));
+}
+
+TEST(Take, LargeCountBidirectionalIterator) {
+    std::list<int> data{1, 2, 3};
+    auto my_view = data | Take(10);
+    std::vector<int> my_res_reverse;
+    for (auto it = std::reverse_iterator(my_view.end()); it != std::reverse_iterator(my_view.begin()); ++it) {
+        my_res_reverse.push_back(*it);
+    }
+    ASSERT_EQ(my_res_reverse, std::vector<int>({3, 2, 1}));
+}
+
+TEST(Drop, Lazy) {
+    std::forward_list<int> data{1, 2, 3, 4, 5, 6, 7, 8};
+    static size_t calls;
+    calls = 0;
+    auto predicate = [](int x){++calls; return x % 2 == 0;};
+    auto my_view = data | Filter(predicate) | Drop(2);
+    ASSERT_EQ(calls, 2);
+    std::vector<int> my_res;
+    for (auto x: my_view) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({6, 8}));
+    size_t first_pass = calls;
+    my_res.clear();
+    for (auto x: my_view) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({6, 8}));
+    ASSERT_EQ(calls - first_pass, 2);
+}
+
 TEST(Values, Empty) {
     std::forward_list<std::pair<int, int>> data;
     std::vector<int> my_res;
@@ -521,6 +588,20 @@ TEST(Conveyor, TransformValues) {
     ASSERT_EQ(my_res, real_res);
 }
 
+TEST(Conveyor, TransformValuesOwned) {
+    auto transform = [](const std::pair<const int, int>& x) {
+        return std::pair<int, std::string>(x.first, std::string(40, char('a' + x.second)));
+    };
+    std::map<int, int> data{{1, 2}, {3, 4}, {5, 2}};
+    std::vector<std::string> my_res;
+    for (auto x: data | Transform(transform) | Values()) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<std::string>({std::string(40, 'c'), std::string(40, 'e'), std::string(40, 'c')}));
+    ASSERT_TRUE((std::is_same_v<decltype(*(data | Transform(transform) | Values()).begin()), std::string>));
+    ASSERT_TRUE((std::is_same_v<decltype(*(data | Values()).begin()), int&>));
+}
+
 TEST(Conveyor, ValuesTake) {
     size_t n = 3;
     std::map<int, int> data{{1, 2}, {3, 4} , {5, 2}, {7, 8}, {9, 2}};
@@ -591,4 +672,642 @@ TEST(Conveyor, TransformReverse) {
         real_res.push_back(x);
     }
     ASSERT_EQ(my_res, real_res);
-}
\ No newline at end of file
+}
+TEST(Terminal, Reduce) {
+    auto predicate = [](int x){return x % 3 != 0;};
+    auto trans = [](int x){return x * x;};
+    std::vector<int> data(1000);
+    std::iota(data.begin(), data.end(), -500);
+    long long my_res = data | Filter(predicate) | Transform(trans) | Reduce(0LL);
+    long long real_res = 0;
+    for (auto x: data | std::views::filter(predicate) | std::views::transform(trans)) {
+        real_res += x;
+    }
+    ASSERT_EQ(my_res, real_res);
+    auto concat = [](std::string acc, int x){return acc + std::to_string(x);};
+    ASSERT_EQ(data | Drop(995) | Reduce(std::string(), concat), "495496497498499");
+}
+
+TEST(Terminal, To) {
+    auto predicate = [](int x){return x % 2 == 0;};
+    std::list<int> data{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto my_res = data | Filter(predicate) | Reverse() | Take(3) | To<std::vector<int>>();
+    std::vector<int> real_res;
+    for (auto x: data | std::views::filter(predicate) | std::views::reverse | std::views::take(3)) {
+        real_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, real_res);
+    std::map<int, int> pairs{{1, 2}, {3, 4}, {5, 2}};
+    ASSERT_EQ(pairs | Values() | To<std::set<int>>(), std::set<int>({2, 4}));
+}
+
+TEST(Terminal, TakeStopsEarly) {
+    static size_t calls;
+    calls = 0;
+    auto predicate = [](int x){++calls; return x % 2 == 0;};
+    std::forward_list<int> data{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto filtered = data | Filter(predicate);
+    ASSERT_EQ(calls, 0);
+    ASSERT_EQ(filtered | Take(2) | Count(), 2);
+    // 1 and 2 to find the start once it runs, then 3 and 4
+    ASSERT_EQ(calls, 4);
+    ASSERT_EQ(data | Take(0) | Count(), 0);
+    ASSERT_EQ(data | Take(100) | Count(), 10);
+}
+
+TEST(Terminal, ForEach) {
+    std::map<int, int> data{{1, 2}, {3, 4} , {5, 2}, {7, 8}, {9, 2}};
+    std::vector<int> my_res;
+    data | Keys() | Transform([](int x){return x + 1;}) | ForEach([&my_res](int x){my_res.push_back(x);});
+    ASSERT_EQ(my_res, std::vector<int>({2, 4, 6, 8, 10}));
+}
+
+TEST(Terminal, ToReserves) {
+    std::vector<int> data(1000);
+    std::iota(data.begin(), data.end(), 0);
+    auto trans = [](int x){return x * 2;};
+    auto my_res = data | Drop(10) | Transform(trans) | Reverse() | Take(977) | To<std::vector<int>>();
+    ASSERT_EQ(my_res.size(), 977);
+    ASSERT_EQ(my_res.capacity(), 977);
+    ASSERT_EQ(my_res.front(), 1998);
+    ASSERT_EQ(my_res.back(), 46);
+}
+
+TEST(Sizes, Propagation) {
+    std::vector<int> data(100);
+    std::vector<std::pair<int, int>> pairs(30);
+    auto trans = [](int x){return x + 1;};
+    ASSERT_EQ((data | Take(10)).size(), 10);
+    ASSERT_EQ((data | Take(1000)).size(), 100);
+    ASSERT_EQ((data | Drop(10)).size(), 90);
+    ASSERT_EQ((data | Drop(1000)).size(), 0);
+    ASSERT_EQ((data | Transform(trans) | Reverse()).size(), 100);
+    ASSERT_EQ((data | Transform(trans) | Transform(trans) | Take(5)).size(), 5);
+    ASSERT_EQ((pairs | Values() | Drop(5)).size(), 25);
+    ASSERT_EQ((data | Drop(3) | Take(4)).data(), data.data() + 3);
+    static_assert(std::contiguous_iterator<decltype((data | Drop(3) | Take(4)).begin())>);
+    static_assert(!SizedView<decltype(data | Filter([](int x){return x > 0;}))>);
+    std::list<int> list(10);
+    static_assert(!SizedView<decltype(list | Reverse())>);
+    static_assert(!SizedView<decltype(list | Take(3))>);
+}
+
+TEST(Cache, TransformCalledOncePerElement) {
+    static size_t calls;
+    auto trans = [](int x){++calls; return x * 3;};
+    auto predicate = [](int x){return x % 2 == 0;};
+    std::vector<int> data{1, 2, 3, 4, 5, 6, 7, 8};
+    std::vector<int> real_res{6, 12, 18, 24};
+
+    calls = 0;
+    std::vector<int> my_res;
+    for (int x: data | Transform(trans) | Filter(predicate)) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, real_res);
+    // the predicate and the loop both dereference every element that passes
+    ASSERT_EQ(calls, data.size() + real_res.size());
+
+    calls = 0;
+    my_res.clear();
+    for (int x: data | Transform(trans) | Cache1() | Filter(predicate)) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, real_res);
+    ASSERT_EQ(calls, data.size());
+
+    calls = 0;
+    my_res.clear();
+    for (int x: data | Transform(trans) | Cache1() | Filter(predicate) | Reverse()) {
+        my_res.push_back(x);
+    }
+    std::reverse(my_res.begin(), my_res.end());
+    ASSERT_EQ(my_res, real_res);
+
+    calls = 0;
+    std::forward_list<int> list(data.begin(), data.end());
+    ASSERT_EQ(list | Transform(trans) | Cache1() | Filter(predicate) | To<std::vector<int>>(), real_res);
+    // the pushed loop does not test the first match again
+    ASSERT_EQ(calls, data.size());
+}
+
+std::vector<int> make_vector(int size) {
+    std::vector<int> result(size);
+    std::iota(result.begin(), result.end(), 0);
+    return result;
+}
+
+TEST(Owning, Temporaries) {
+    auto predicate = [](int x){return x % 2 == 0;};
+    auto trans = [](int x){return x * 10;};
+    auto view = make_vector(10) | Filter(predicate) | Transform(trans) | Reverse();
+    std::vector<int> my_res;
+    for (int x: view) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({80, 60, 40, 20, 0}));
+    auto moved = std::move(view);
+    ASSERT_EQ(moved | To<std::vector<int>>(), my_res);
+
+    // short strings live inside the object, so moving it would break plain iterators
+    auto letters = std::string("abc") | Transform([](char c){return char(c - 'a' + 'A');});
+    ASSERT_EQ(letters | To<std::string>(), "ABC");
+
+    std::map<int, std::string> map{{1, "a"}, {2, "b"}};
+    auto values = std::move(map) | Values() | Drop(1);
+    ASSERT_EQ(*values.begin(), "b");
+}
+
+TEST(Owning, NoCopy) {
+    std::vector<int> data = make_vector(100);
+    const int* elements = data.data();
+    auto view = std::move(data) | Drop(10) | Take(5);
+    ASSERT_EQ(&*view.begin(), elements + 10);
+    ASSERT_EQ(view.size(), 5);
+    ASSERT_EQ(view.data(), elements + 10);
+    ASSERT_EQ(make_vector(100000) | Parallel(4) | Transform([](int x){return x % 3;}) | Reduce(0), 99999);
+
+    std::vector<int> lvalue = make_vector(10);
+    static_assert(std::same_as<decltype((lvalue | Take(2)).begin()), std::vector<int>::iterator>);
+    static_assert(std::same_as<decltype((lvalue | Take(2) | Drop(1)).begin()), std::vector<int>::iterator>);
+    // borrowed ranges are used in place even as temporaries
+    static_assert(std::same_as<decltype((std::span<int>(lvalue) | Take(2)).begin()), std::span<int>::iterator>);
+    static_assert(std::same_as<decltype((std::string_view("abc") | Drop(1)).begin()), std::string_view::iterator>);
+    auto halves = std::span<int>(lvalue) | Filter([](int x){return x < 5;});
+    ASSERT_EQ(&*halves.begin(), lvalue.data());
+}
+
+TEST(Chunk, Blocks) {
+    std::vector<int> data = make_vector(10);
+    auto chunks = data | Chunk(4);
+    static_assert(std::same_as<decltype(*chunks.begin()), std::span<int>>);
+    ASSERT_EQ(chunks.size(), 3);
+    std::vector<int> sums;
+    for (auto chunk: chunks) {
+        sums.push_back(std::accumulate(chunk.begin(), chunk.end(), 0));
+    }
+    ASSERT_EQ(sums, std::vector<int>({6, 22, 17}));
+    ASSERT_EQ((*chunks.begin()).data(), data.data());
+
+    std::list<int> list(data.begin(), data.end());
+    auto sizes = list | Chunk(3) | Transform([](auto chunk){return chunk | Count();}) | To<std::vector<size_t>>();
+    ASSERT_EQ(sizes, std::vector<size_t>({3, 3, 3, 1}));
+    ASSERT_EQ(std::vector<int>() | Chunk(3) | Count(), 0);
+}
+
+TEST(Batch, Buffers) {
+    auto predicate = [](int x){return x % 3 != 0;};
+    std::vector<int> data = make_vector(20);
+    std::vector<std::vector<int>> my_res;
+    for (auto batch: data | Filter(predicate) | Batch(5)) {
+        my_res.emplace_back(batch.begin(), batch.end());
+    }
+    std::vector<std::vector<int>> real_res{{1, 2, 4, 5, 7}, {8, 10, 11, 13, 14}, {16, 17, 19}};
+    ASSERT_EQ(my_res, real_res);
+
+    my_res.clear();
+    data | Filter(predicate) | Batch(5) | ForEach([&my_res](std::span<const int> batch){
+        my_res.emplace_back(batch.begin(), batch.end());
+    });
+    ASSERT_EQ(my_res, real_res);
+}
+
+TEST(Batch, TransformBatch) {
+    static size_t calls;
+    calls = 0;
+    auto kernel = [](std::span<int> block){
+        ++calls;
+        for (int& x: block) {
+            x *= 2;
+        }
+    };
+    std::vector<int> data = make_vector(1000);
+    std::vector<int> real_res(data.size());
+    std::transform(data.begin(), data.end(), real_res.begin(), [](int x){return x * 2;});
+
+    ASSERT_EQ(data | TransformBatch(kernel, 64) | To<std::vector<int>>(), real_res);
+    ASSERT_EQ(calls, 16);
+
+    calls = 0;
+    std::vector<int> my_res;
+    for (int x: data | TransformBatch(kernel)) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, real_res);
+    ASSERT_EQ(calls, 4);
+
+    calls = 0;
+    ASSERT_EQ(data | TransformBatch(kernel, 10) | Take(25) | Reduce(0), 600);
+    ASSERT_EQ(calls, 3);
+    ASSERT_EQ(data | Filter([](int x){return x < 5;}) | TransformBatch(kernel, 3) | To<std::vector<int>>(),
+              std::vector<int>({0, 2, 4, 6, 8}));
+}
+
+TEST(Zip, Pairs) {
+    std::vector<int> keys{1, 2, 3, 4};
+    std::list<std::string> names{"a", "b", "c"};
+    std::vector<std::pair<int, std::string>> my_res;
+    for (auto [key, name]: keys | Zip(names)) {
+        my_res.emplace_back(key, name);
+    }
+    ASSERT_EQ(my_res, (std::vector<std::pair<int, std::string>>{{1, "a"}, {2, "b"}, {3, "c"}}));
+    ASSERT_EQ(keys | Zip(names) | Values() | Reduce(std::string()), "abc");
+
+    std::vector<int> values{10, 20, 30};
+    auto zipped = keys | Zip(values);
+    static_assert(RandomAccessView<decltype(zipped)>);
+    ASSERT_EQ(zipped.size(), 3);
+    ASSERT_EQ((std::pair<int, int>(zipped.begin()[2])), std::make_pair(3, 30));
+    for (auto [key, value]: keys | Zip(values)) {
+        value += key;
+    }
+    ASSERT_EQ(values, std::vector<int>({11, 22, 33}));
+    ASSERT_EQ(keys | Zip(values) | Reverse() | Keys() | To<std::vector<int>>(), std::vector<int>({3, 2, 1}));
+    ASSERT_EQ(keys | Zip(make_vector(2)) | Count(), 2);
+}
+
+TEST(Enumerate, Indices) {
+    std::vector<std::string> words{"x", "y", "z"};
+    auto enumerated = words | Enumerate();
+    static_assert(RandomAccessView<decltype(enumerated)>);
+    ASSERT_EQ((std::pair<size_t, std::string>(enumerated.begin()[1])), std::make_pair(size_t(1), std::string("y")));
+    ASSERT_EQ(words | Enumerate() | Keys() | To<std::vector<size_t>>(), std::vector<size_t>({0, 1, 2}));
+    ASSERT_EQ(words | Enumerate() | Reverse() | Keys() | To<std::vector<size_t>>(), std::vector<size_t>({2, 1, 0}));
+
+    std::list<int> list{5, 6, 7, 8};
+    auto odd_positions = list | Enumerate() | Filter([](auto p){return p.first % 2 == 1;}) | Values();
+    ASSERT_EQ(odd_positions | To<std::vector<int>>(), std::vector<int>({6, 8}));
+    std::vector<int> my_res;
+    for (int x: odd_positions | Reverse()) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({8, 6}));
+}
+
+TEST(Enumerate, LazyEnd) {
+    static size_t calls;
+    calls = 0;
+    auto predicate = [](int x){++calls; return x % 2 == 0;};
+    std::list<int> list(100000, 2);
+    auto view = list | Filter(predicate) | Enumerate();
+    calls = 0;
+    view.end();
+    ASSERT_EQ(calls, 0);
+    ASSERT_EQ(view | Take(3) | Keys() | To<std::vector<size_t>>(), std::vector<size_t>({0, 1, 2}));
+    ASSERT_LT(calls, 10);
+    auto last = view.end();
+    ASSERT_EQ((*--last).first, 99999);
+    ASSERT_EQ((*--last).first, 99998);
+}
+
+TEST(Join, Flatten) {
+    std::vector<std::vector<int>> nested{{1, 2}, {}, {3}, {}, {4, 5, 6}, {}};
+    std::vector<int> my_res;
+    for (int x: nested | Join()) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({1, 2, 3, 4, 5, 6}));
+    ASSERT_EQ(nested | Flatten() | Reduce(0), 21);
+    ASSERT_EQ(nested | Join() | Drop(1) | Take(4) | To<std::vector<int>>(), std::vector<int>({2, 3, 4, 5}));
+    ASSERT_EQ(std::vector<std::vector<int>>(3) | Join() | Count(), 0);
+
+    std::vector<int> data = make_vector(10);
+    ASSERT_EQ(data | Chunk(3) | Join() | To<std::vector<int>>(), data);
+    std::list<int> list(data.begin(), data.end());
+    ASSERT_EQ(list | Chunk(4) | Join() | Filter([](int x){return x % 2 == 0;}) | Count(), 5);
+    static_assert(!JoinableView<decltype(data | Transform([](int x){return std::vector<int>(x);}))>);
+}
+
+// a file in the temp directory with a name of its own per process and
+// test, removed when the test is over
+class TempFile {
+public:
+    TempFile(const std::string& name, const std::string& content) {
+        static int created = 0;
+        auto unique = std::to_string(getpid()) + "_" + std::to_string(created++) + "_" + name;
+        path = (std::filesystem::temp_directory_path() / unique).string();
+        std::ofstream(path, std::ios::binary) << content;
+    }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    ~TempFile() {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+
+    const std::string& get_path() const {
+        return path;
+    }
+private:
+    std::string path;
+};
+
+TEST(Mapped, Lines) {
+    TempFile file("ranges_mapped_lines.txt", "GET /a\nPOST /b\n\nGET /cc\nGET /d\n");
+    const auto& path = file.get_path();
+    MappedLines lines(path);
+    std::vector<std::string_view> my_res;
+    for (auto line: lines) {
+        my_res.push_back(line);
+    }
+    ASSERT_EQ(my_res, std::vector<std::string_view>({"GET /a", "POST /b", "", "GET /cc", "GET /d"}));
+
+    auto is_get = [](std::string_view line){return line.starts_with("GET");};
+    auto length = [](std::string_view line){return line.size();};
+    ASSERT_EQ(MappedLines(path) | Filter(is_get) | Transform(length) | Take(2) | To<std::vector<size_t>>(),
+              std::vector<size_t>({6, 7}));
+    auto view = MappedLines(path) | Drop(3);
+    ASSERT_EQ(*view.begin(), "GET /cc");
+
+    TempFile no_newline("ranges_mapped_no_newline.txt", "x\ny");
+    ASSERT_EQ(MappedLines(no_newline.get_path()) | Count(), 2);
+    TempFile empty("ranges_mapped_empty.txt", "");
+    ASSERT_EQ(MappedLines(empty.get_path()) | Count(), 0);
+    ASSERT_THROW(MappedLines("/nonexistent/ranges_mapped_lines.txt"), std::system_error);
+}
+
+struct Record {
+    int32_t id;
+    float value;
+};
+
+TEST(Mapped, Records) {
+    std::vector<Record> records;
+    for (int i = 0; i < 10000; ++i) {
+        records.push_back({i, i * 0.5f});
+    }
+    std::string content(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+    TempFile file("ranges_mapped_records.bin", content + "xyz");
+    const auto& path = file.get_path();
+
+    MappedRecords<Record> mapped(path);
+    ASSERT_EQ(mapped.size(), records.size());
+    static_assert(std::contiguous_iterator<decltype((mapped | Drop(5)).begin())>);
+    auto ids = [](const Record& record){return record.id;};
+    ASSERT_EQ(mapped | Filter([](const Record& record){return record.value >= 4000;}) | Transform(ids) | Take(3) |
+              To<std::vector<int>>(), std::vector<int>({8000, 8001, 8002}));
+    long long real_res = 10000LL * 9999 / 2;
+    ASSERT_EQ(MappedRecords<Record>(path) | Parallel(4) | Transform(ids) | Reduce(0LL), real_res);
+}
+
+Generator<int> naturals() {
+    for (int i = 0;; ++i) {
+        co_yield i;
+    }
+}
+
+Generator<std::string> words(int count) {
+    for (int i = 0; i < count; ++i) {
+        co_yield std::string(i + 1, 'a');
+    }
+}
+
+Generator<int> failing() {
+    co_yield 1;
+    throw std::runtime_error("failed");
+}
+
+TEST(Generator, Source) {
+    auto odd = [](int x){return x % 2 == 1;};
+    ASSERT_EQ(naturals() | Filter(odd) | Take(4) | To<std::vector<int>>(), std::vector<int>({1, 3, 5, 7}));
+    auto square = [](int x){return x * x;};
+    ASSERT_EQ(naturals() | Transform(square) | Drop(2) | Take(3) | Reduce(0), 4 + 9 + 16);
+
+    std::vector<size_t> sizes;
+    for (const auto& word: words(4)) {
+        sizes.push_back(word.size());
+    }
+    ASSERT_EQ(sizes, std::vector<size_t>({1, 2, 3, 4}));
+    auto gen = words(3);
+    ASSERT_EQ(gen | Transform([](const std::string& word){return word.size();}) | Reduce(size_t(0)), 6);
+    ASSERT_EQ(words(0) | Count(), 0);
+    ASSERT_THROW(failing() | Count(), std::runtime_error);
+}
+
+Generator<int> count_to(int count) {
+    for (int i = 1; i <= count; ++i) {
+        co_yield i;
+    }
+}
+
+template <typename V, typename A>
+concept Pipeable = requires(V view, A adapter) {
+    std::forward<V>(view) | adapter;
+};
+
+TEST(Generator, SinglePass) {
+    static_assert(std::input_iterator<Generator<int>::iterator> && !std::forward_iterator<Generator<int>::iterator>);
+    static_assert(!std::forward_iterator<decltype((count_to(3) | Filter([](int){return true;})).begin())>);
+    static_assert(!std::forward_iterator<decltype((std::vector<int>() | Async(4)).begin())>);
+    // Chunk and Batch keep positions to come back to, a single pass source
+    // has to be collected first
+    static_assert(!Pipeable<Generator<int>, Batch> && !Pipeable<Generator<int>, Chunk>);
+    static_assert(!Pipeable<decltype(std::vector<int>() | Async(4)), Chunk>);
+
+    std::vector<size_t> sizes;
+    for (auto batch: count_to(7) | To<std::vector<int>>() | Batch(5)) {
+        sizes.push_back(batch.size());
+    }
+    ASSERT_EQ(sizes, std::vector<size_t>({5, 2}));
+    std::vector<int> sums;
+    for (auto chunk: count_to(7) | To<std::vector<int>>() | Chunk(3)) {
+        sums.push_back(std::accumulate(chunk.begin(), chunk.end(), 0));
+    }
+    ASSERT_EQ(sums, std::vector<int>({6, 15, 7}));
+    ASSERT_EQ(count_to(7) | Drop(2) | Take(4) | Reduce(0), 3 + 4 + 5 + 6);
+}
+
+Generator<int> slow_pair(std::chrono::milliseconds pause) {
+    co_yield 1;
+    std::this_thread::sleep_for(pause);
+    co_yield 2;
+    std::this_thread::sleep_for(5 * pause);
+}
+
+TEST(Async, HandsOverAtOnce) {
+    // the consumer is blocked on the empty queue when 2 comes, it must not
+    // wait for the queue to fill or the producer to finish
+    auto view = slow_pair(std::chrono::milliseconds(200)) | Async(64);
+    auto it = view.begin();
+    ASSERT_EQ(*it, 1);
+    auto start = std::chrono::steady_clock::now();
+    ++it;
+    ASSERT_EQ(*it, 2);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(600));
+}
+
+TEST(Async, Overlaps) {
+    auto trans = [](int x){return x * 3;};
+    auto predicate = [](int x){return x % 2 == 0;};
+    std::vector<int> data = make_vector(100000);
+    long long real_res = data | Transform(trans) | Filter(predicate) | Reduce(0LL);
+    ASSERT_EQ(data | Transform(trans) | Async(16) | Filter(predicate) | Reduce(0LL), real_res);
+    ASSERT_EQ(data | Async(1) | To<std::vector<int>>(), data);
+
+    std::vector<int> my_res;
+    for (int x: words(5) | Transform([](const std::string& word){return int(word.size());}) | Async(2)) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({1, 2, 3, 4, 5}));
+
+    // the consumer stops early, the producer of the infinite source has to stop too
+    ASSERT_EQ(naturals() | Async(8) | Take(10) | Reduce(0), 45);
+    auto view = naturals() | Async(4);
+    ASSERT_EQ(*view.begin(), 0);
+    ASSERT_THROW(failing() | Async(4) | Count(), std::runtime_error);
+    ASSERT_EQ(std::vector<int>() | Async(4) | Count(), 0);
+}
+
+TEST(Pipeline, Closure) {
+    auto predicate = [](int x){return x % 3 != 0;};
+    auto trans = [](int x){return x * 2;};
+    auto pipeline = Filter(predicate) | Transform(trans) | Take(4);
+    std::vector<int> data = make_vector(100);
+    std::list<int> list(data.begin(), data.end());
+    auto real_res = data | Filter(predicate) | Transform(trans) | Take(4) | To<std::vector<int>>();
+    ASSERT_EQ(data | pipeline | To<std::vector<int>>(), real_res);
+    ASSERT_EQ(list | pipeline | To<std::vector<int>>(), real_res);
+    ASSERT_EQ(std::vector<int>({1, 2, 3}) | pipeline | Reduce(0), 2 + 4);
+
+    auto sum = Drop(1) | pipeline | Reduce(0);
+    ASSERT_EQ(data | sum, (data | Drop(1) | pipeline | Reduce(0)));
+    ASSERT_EQ(data | (Reverse() | pipeline) | Count(), 4);
+}
+
+TEST(Pipeline, Fusion) {
+    auto plus = [](int x){return x + 1;};
+    auto twice = [](int x){return x * 2;};
+    auto even = [](int x){return x % 2 == 0;};
+    auto small = [](int x){return x < 10;};
+    std::vector<int> data = make_vector(20);
+    using It = std::vector<int>::iterator;
+
+    auto transforms = data | Transform(plus) | Transform(twice);
+    static_assert(std::is_same_v<decltype(transforms.begin()),
+                                 TransformRandomAccessIterator<It, Composition<decltype(plus), decltype(twice)>>>);
+    ASSERT_EQ(transforms | To<std::vector<int>>(), (data | Transform([](int x){return (x + 1) * 2;}) | To<std::vector<int>>()));
+    auto filters = data | Filter(even) | Filter(small);
+    static_assert(std::is_same_v<decltype(filters), FilterView<It, Conjunction<decltype(even), decltype(small)>>>);
+    ASSERT_EQ(filters | To<std::vector<int>>(), std::vector<int>({0, 2, 4, 6, 8}));
+    static_assert(std::is_same_v<decltype(data | Take(5) | Take(3)), TakeView<It>>);
+    ASSERT_EQ(data | Take(5) | Take(3) | Count(), 3);
+    ASSERT_EQ(data | Take(3) | Take(5) | Count(), 3);
+    auto drops = data | Drop(5);
+    ASSERT_EQ(*drops.begin(), 5);
+    static_assert(std::is_same_v<decltype(drops | Drop(3)), DropView<It>>);
+    ASSERT_EQ(*(drops | Drop(3)).begin(), 8);
+    ASSERT_EQ(*(data | Drop(5) | Drop(3)).begin(), 8);
+
+    static_assert(std::is_same_v<decltype(Transform(plus) | Transform(twice)),
+                                 Transform<Composition<decltype(plus), decltype(twice)>>>);
+    static_assert(std::is_same_v<decltype(Take(5) | Filter(even) | Take(2) | Take(1)),
+                                 Pipeline<Pipeline<Take, Filter<decltype(even)>>, Take>>);
+    auto pipeline = Drop(1) | Drop(2) | Filter(even) | (Filter(small) | Transform(plus)) | Transform(twice);
+    static_assert(std::is_same_v<decltype(pipeline),
+                                 Pipeline<Pipeline<Drop, Filter<Conjunction<decltype(even), decltype(small)>>>,
+                                          Transform<Composition<decltype(plus), decltype(twice)>>>>);
+    ASSERT_EQ(pipeline.left.left.shift, 3);
+    ASSERT_EQ(data | pipeline | To<std::vector<int>>(), std::vector<int>({10, 14, 18}));
+    ASSERT_EQ((Take(7) | Take(4)).n, 4);
+
+    const size_t max = std::numeric_limits<size_t>::max();
+    ASSERT_EQ((Drop(max) | Drop(1)).shift, max);
+    ASSERT_EQ(data | Drop(max) | Count(), 0);
+    ASSERT_EQ(data | Drop(max) | Drop(1) | Count(), 0);
+    std::list<int> list(data.begin(), data.end());
+    ASSERT_EQ(list | Drop(max - 1) | Drop(5) | Count(), 0);
+}
+
+TEST(Parallel, Reduce) {
+    auto predicate = [](int x){return x % 3 != 0;};
+    auto trans = [](int x){return static_cast<long long>(x) * x;};
+    std::vector<int> data(100000);
+    std::iota(data.begin(), data.end(), -50000);
+    long long real_res = data | Filter(predicate) | Transform(trans) | Reduce(0LL);
+    for (size_t threads: {1, 2, 4, 7}) {
+        ASSERT_EQ(data | Parallel(threads) | Filter(predicate) | Transform(trans) | Reduce(0LL), real_res);
+    }
+    ASSERT_EQ(data | Parallel(4) | Filter(predicate) | Count(), data | Filter(predicate) | Count());
+    ASSERT_EQ(data | Parallel(4) | Drop(99990) | Reduce(0), 49990 + 49991 + 49992 + 49993 + 49994 + 49995 +
+                                                          49996 + 49997 + 49998 + 49999);
+}
+
+TEST(Parallel, ReduceInit) {
+    std::vector<int> data(100000, 1);
+    for (size_t threads: {1, 2, 4, 7}) {
+        ASSERT_EQ(data | Parallel(threads) | Reduce(100), 100100);
+        // most parts have nothing left after the filter
+        ASSERT_EQ(data | Parallel(threads) | Filter([](int){return false;}) | Reduce(100), 100);
+    }
+    std::vector<std::string> words(1000);
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] = std::string(1, char('a' + i % 26));
+    }
+    auto concat = [](std::string left, const std::string& right){return left + right;};
+    ASSERT_EQ(words | Parallel(4) | Reduce(std::string(">"), concat), words | Reduce(std::string(">"), concat));
+}
+
+TEST(Parallel, Exceptions) {
+    std::vector<int> data(100000);
+    std::iota(data.begin(), data.end(), 0);
+    auto throwing = [](int x) {
+        if (x == 77777) {
+            throw std::runtime_error("bad element");
+        }
+        return x;
+    };
+    for (size_t threads: {1, 4}) {
+        ASSERT_THROW(data | Parallel(threads) | Transform(throwing) | Reduce(0), std::runtime_error);
+        ASSERT_THROW(data | Parallel(threads) | Transform(throwing) | To<std::vector<int>>(), std::runtime_error);
+        auto even = [](int x) {
+            if (x == 77777) {
+                throw std::runtime_error("bad element");
+            }
+            return x % 2 == 0;
+        };
+        ASSERT_THROW(data | Parallel(threads) | Filter(even) | Count(), std::runtime_error);
+    }
+    // the pool is usable after a failure
+    ASSERT_EQ(data | Parallel(4) | Count(), data.size());
+}
+
+TEST(Parallel, ToKeepsOrder) {
+    auto predicate = [](int x){return x % 7 == 0;};
+    auto trans = [](int x){return x / 7;};
+    std::vector<int> data(100000);
+    std::iota(data.begin(), data.end(), 0);
+    auto my_res = data | Parallel(4) | Filter(predicate) | Transform(trans) | To<std::vector<int>>();
+    std::vector<int> real_res((data.size() + 6) / 7);
+    std::iota(real_res.begin(), real_res.end(), 0);
+    ASSERT_EQ(my_res, real_res);
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < 5000; ++i) {
+        pairs.emplace_back(i, i % 10);
+    }
+    ASSERT_EQ(pairs | Parallel(3) | Values() | To<std::set<int>>(), std::set<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    std::vector<int> empty;
+    ASSERT_TRUE((empty | Parallel(4) | Filter(predicate) | To<std::vector<int>>()).empty());
+}
+
+TEST(Parallel, ForEach) {
+    std::vector<int> data(100000, 1);
+    std::atomic<long long> sum = 0;
+    data | Parallel(4) | Transform([](int x){return x * 2;}) | ForEach([&sum](int x){sum += x;});
+    ASSERT_EQ(sum, 200000);
+}
+
+TEST(Parallel, SequentialStages) {
+    auto predicate = [](int x){return x % 2 == 0;};
+    std::vector<int> data(10000);
+    std::iota(data.begin(), data.end(), 0);
+    // Take after Filter and Reverse depend on the previous elements, so they run in one thread
+    ASSERT_EQ(data | Parallel(4) | Filter(predicate) | Take(3) | To<std::vector<int>>(), std::vector<int>({0, 2, 4}));
+    ASSERT_EQ(data | Parallel(4) | Reverse() | Take(2) | To<std::vector<int>>(), std::vector<int>({9999, 9998}));
+    std::vector<int> my_res;
+    for (int x: data | Parallel(4) | Take(3)) {
+        my_res.push_back(x);
+    }
+    ASSERT_EQ(my_res, std::vector<int>({0, 1, 2}));
+}